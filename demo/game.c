@@ -7,9 +7,13 @@
 
 #include "asset.h"
 #include "asset_cache.h"
+#include "body_handle.h"
 #include "collision.h"
+#include "contact_table.h"
 #include "forces.h"
+#include "local_shape.h"
 #include "sdl_wrapper.h"
+#include "shape_view.h"
 
 // window constants
 const vector_t MIN = {0, 0};
@@ -178,6 +182,21 @@ const vector_t ELEVATOR_DOWN = (vector_t){0, -20};
 // gravity constants
 const double GRAVITY = 320;
 
+// broadphase constants
+const double GRID_CELL_SIZE = 50;
+
+// the simulation always advances by steps of this length, however long
+// frames take, so each step costs the same and behaves the same
+const double FIXED_TICK_TIME = 1.0 / 60;
+// longest frame simulated; longer frames are shortened to this, so a stalled
+// tab does not come back to a long run of catch-up steps
+const double MAX_TICK_TIME = 0.1;
+
+// the spirit falls asleep once it has been slower than this speed for this
+// many ticks in a row
+const double SLEEP_SPEED = 1;
+const size_t SLEEP_TICKS = 30;
+
 bool game_over = false;
 
 typedef enum {
@@ -187,8 +206,37 @@ typedef enum {
   HOMEPAGE = 4,
 } screen_t;
 
+// collision layers
+typedef enum {
+  SPIRIT_LAYER = 1 << 0,
+  SOLID_LAYER = 1 << 1, // platforms, elevators, doors and buttons
+  HAZARD_LAYER = 1 << 2,
+  GEM_LAYER = 1 << 3,
+  EXIT_LAYER = 1 << 4,
+  SCENERY_LAYER = 1 << 5, // water, which nothing collides with
+} layer_t;
+
+// what each kind of body belongs to and collides with
+const collision_filter_t SPIRIT_FILTER = {
+    SPIRIT_LAYER, SOLID_LAYER | HAZARD_LAYER | GEM_LAYER | EXIT_LAYER};
+const collision_filter_t SOLID_FILTER = {SOLID_LAYER, SPIRIT_LAYER};
+const collision_filter_t HAZARD_FILTER = {HAZARD_LAYER, SPIRIT_LAYER};
+const collision_filter_t GEM_FILTER = {GEM_LAYER, SPIRIT_LAYER};
+const collision_filter_t EXIT_FILTER = {EXIT_LAYER, SPIRIT_LAYER};
+const collision_filter_t SCENERY_FILTER = {SCENERY_LAYER, 0};
+
+// what the spirit looks for when checking for ground and walls, and exits
+const collision_filter_t SPIRIT_SOLID_QUERY = {SPIRIT_LAYER, SOLID_LAYER};
+const collision_filter_t SPIRIT_EXIT_QUERY = {SPIRIT_LAYER, EXIT_LAYER};
+// what the spirit's hazard and gem groups look for
+const collision_filter_t SPIRIT_HAZARD_QUERY = {SPIRIT_LAYER, HAZARD_LAYER};
+const collision_filter_t SPIRIT_GEM_QUERY = {SPIRIT_LAYER, GEM_LAYER};
+
 struct state {
   scene_t *scene;
+  list_t *removed_bodies;
+  collision_cache_t *collision_cache;
+  contact_table_t *button_contacts;
   screen_t current_screen;
   collision_type_t collision_type;
   bool pause;
@@ -196,58 +244,65 @@ struct state {
   double level_points[3];
   bool level_completed[3];
   double time;
+  // real time not yet simulated, always less than one step between frames
+  double accumulator;
   TTF_Font *font;
 };
 
-body_t *make_obstacle(size_t w, size_t h, vector_t center, char *info) {
-  list_t *c = list_init(4, free);
-  vector_t *v1 = malloc(sizeof(vector_t));
-
-  *v1 = (vector_t){0, 0};
-  list_add(c, v1);
-
-  vector_t *v2 = malloc(sizeof(vector_t));
-  *v2 = (vector_t){w, 0};
-  list_add(c, v2);
-
-  vector_t *v3 = malloc(sizeof(vector_t));
-  *v3 = (vector_t){w, h};
-  list_add(c, v3);
-
-  vector_t *v4 = malloc(sizeof(vector_t));
-  *v4 = (vector_t){0, h};
-  list_add(c, v4);
+// builds a body from the shared local shape with the given vertices, so that
+// identical bodies share one copy of their vertices and edge normals
+body_t *make_shared_body(const vector_t *vertices, size_t size,
+                         vector_t centroid, double mass, color_t color,
+                         char *info) {
+  local_shape_t *shape = local_shape_get(vertices, size);
+  body_t *body = body_init_with_info(local_shape_place(shape, centroid), mass,
+                                     color, info, NULL);
+  body_set_local_shape(body, shape);
+  local_shape_release(shape);
+  return body;
+}
 
-  body_t *obstacle = body_init_with_info(c, __DBL_MAX__, OBS_COLOR, info, NULL);
+body_t *make_obstacle(size_t w, size_t h, vector_t center, char *info) {
+  double half_w = w / 2.0;
+  double half_h = h / 2.0;
+  vector_t vertices[4] = {{-half_w, -half_h},
+                          {half_w, -half_h},
+                          {half_w, half_h},
+                          {-half_w, half_h}};
+  body_t *obstacle =
+      make_shared_body(vertices, 4, center, __DBL_MAX__, OBS_COLOR, info);
   body_set_centroid(obstacle, center);
   return obstacle;
 }
 
-body_t *make_spirit(double outer_radius, double inner_radius, vector_t center) {
-  center.y += inner_radius;
-  list_t *c = list_init(SPIRIT_NUM_POINTS, free);
+// fills in the vertices of the ellipse the spirit and gems are drawn as
+void get_spirit_vertices(double outer_radius, double inner_radius,
+                         vector_t *vertices) {
   for (size_t i = 0; i < SPIRIT_NUM_POINTS; i++) {
     double angle = 2 * M_PI * i / SPIRIT_NUM_POINTS;
-    vector_t *v = malloc(sizeof(*v));
-    *v = (vector_t){center.x + inner_radius * cos(angle),
-                    center.y + outer_radius * sin(angle)};
-    list_add(c, v);
+    vertices[i] =
+        (vector_t){inner_radius * cos(angle), outer_radius * sin(angle)};
   }
-  body_t *spirit = body_init(c, 1, SPIRIT_COLOR);
+}
+
+body_t *make_spirit(double outer_radius, double inner_radius, vector_t center) {
+  center.y += inner_radius;
+  vector_t vertices[SPIRIT_NUM_POINTS];
+  get_spirit_vertices(outer_radius, inner_radius, vertices);
+  body_t *spirit = make_shared_body(vertices, SPIRIT_NUM_POINTS, center, 1,
+                                    SPIRIT_COLOR, NULL);
+  // collides as the exact ellipse its vertices are drawn from
+  shape_view_set_ellipse(spirit);
   return spirit;
 }
 
 body_t *make_gem(double outer_radius, double inner_radius, vector_t center) {
   center.y += inner_radius;
-  list_t *c = list_init(SPIRIT_NUM_POINTS, free);
-  for (size_t i = 0; i < SPIRIT_NUM_POINTS; i++) {
-    double angle = 2 * M_PI * i / SPIRIT_NUM_POINTS;
-    vector_t *v = malloc(sizeof(*v));
-    *v = (vector_t){center.x + inner_radius * cos(angle),
-                    center.y + outer_radius * sin(angle)};
-    list_add(c, v);
-  }
-  body_t *gem = body_init_with_info(c, 1, OBS_COLOR, "gem", NULL);
+  vector_t vertices[SPIRIT_NUM_POINTS];
+  get_spirit_vertices(outer_radius, inner_radius, vertices);
+  body_t *gem = make_shared_body(vertices, SPIRIT_NUM_POINTS, center, 1,
+                                 OBS_COLOR, "gem");
+  shape_view_set_ellipse(gem);
   return gem;
 }
 
@@ -276,43 +331,100 @@ void win_handler(body_t *body1, body_t *body2, vector_t axis, void *aux,
   game_over = true;
 }
 
+// removes a body from the game; the scene frees it during its next tick
+void remove_body(state_t *state, body_t *body) {
+  body_remove(body);
+  list_add(state->removed_bodies, body);
+}
+
+// forgets the cached pairs of the bodies the last tick freed; this
+// waits until after the tick because its force creators may still test them
+// until then
+void forget_removed_bodies(state_t *state) {
+  for (size_t i = 0; i < list_size(state->removed_bodies); i++) {
+    body_t *removed = list_get(state->removed_bodies, i);
+    collision_cache_remove(state->collision_cache, removed);
+  }
+  while (list_size(state->removed_bodies) > 0) {
+    list_remove(state->removed_bodies, list_size(state->removed_bodies) - 1);
+  }
+}
+
 // when the user collides with a gem
 void gem_user_handler(body_t *body1, body_t *body2, vector_t axis, void *aux,
                       double force_const) {
-  asset_remove_body(body2);
-  body_remove(body2);
+  state_t *state = aux;
+  remove_body(state, body2);
   sdl_play_gem_sound(GEM_SOUND_PATH);
 }
 
+// whether the spirit is standing on top of a platform with the given bounds
+bool is_above(vector_t cen, vector_t min, vector_t max) {
+  return cen.x > min.x - INNER_RADIUS && cen.x < max.x + INNER_RADIUS &&
+         cen.y - (INNER_RADIUS - 8) >= max.y;
+}
+
+// whether the spirit is pressed against the bottom of a platform
+bool is_below(vector_t cen, vector_t min, vector_t max) {
+  return cen.x > min.x - INNER_RADIUS && cen.x < max.x + INNER_RADIUS &&
+         cen.y < min.y;
+}
+
+// whether the spirit is pressed against the left side of a platform
+bool is_left_of(vector_t cen, vector_t min, vector_t max) {
+  return cen.y > min.y - OUTER_RADIUS && cen.y < max.y + OUTER_RADIUS &&
+         cen.x < min.x;
+}
+
+// whether the spirit is pressed against the right side of a platform
+bool is_right_of(vector_t cen, vector_t min, vector_t max) {
+  return cen.y > min.y - OUTER_RADIUS && cen.y < max.y + OUTER_RADIUS &&
+         cen.x > max.x;
+}
+
+// finds which face of a platform the spirit is against, checking the top
+// first so the spirit can stand on the lip of a ledge
+collision_type_t get_contact_face(vector_t cen, body_t *platform) {
+  vector_t min;
+  vector_t max;
+  find_bounding_box(platform, &min, &max);
+  if (is_above(cen, min, max)) {
+    return UP_COLLISION;
+  }
+  if (is_below(cen, min, max)) {
+    return DOWN_COLLISION;
+  }
+  if (is_left_of(cen, min, max)) {
+    return LEFT_COLLISION;
+  }
+  if (is_right_of(cen, min, max)) {
+    return RIGHT_COLLISION;
+  }
+  return NO_COLLISION;
+}
+
 // when the user collides with a platform
 void platform_handler(body_t *body1, body_t *body2, vector_t axis, void *aux,
                       double force_const) {
-
   vector_t vel = body_get_velocity(body1);
   vector_t cen = body_get_centroid(body1);
-  list_t *pts = body_get_shape(body2);
-  vector_t *v1 = list_get(pts, 0);
-  vector_t *v2 = list_get(pts, 1);
-  vector_t *v3 = list_get(pts, 2);
-  vector_t *v4 = list_get(pts, 3);
-
-  if (cen.x > v4->x - INNER_RADIUS && cen.x < v3->x + INNER_RADIUS &&
-      cen.y - (INNER_RADIUS - 8) >= v4->y) {
+  vector_t min;
+  vector_t max;
+  find_bounding_box(body2, &min, &max);
+
+  if (is_above(cen, min, max)) {
     vel.y = 0;
   }
 
-  if (cen.x > v1->x - INNER_RADIUS && cen.x < v2->x + INNER_RADIUS &&
-      cen.y < v1->y) {
+  if (is_below(cen, min, max)) {
     vel.y = -vel.y;
   }
 
-  if (cen.y > v1->y - OUTER_RADIUS && cen.y < v4->y + OUTER_RADIUS &&
-      cen.x < v1->x) {
+  if (is_left_of(cen, min, max)) {
     vel.x = 0;
   }
 
-  if (cen.y > v2->y - OUTER_RADIUS && cen.y < v3->y + OUTER_RADIUS &&
-      cen.x > v2->x) {
+  if (is_right_of(cen, min, max)) {
     vel.x = 0;
   }
 
@@ -323,6 +435,24 @@ vector_t get_dimensions_for_text(char *text) {
   return (vector_t){strlen(text) * TEXT_SIZE, TEXT_SIZE * TEXT_HEIGHT_SCALE};
 }
 
+// adds a body of the given kind to the scene, filed in its broadphase under
+// the given filter; the spirit is dynamic, elevators are kinematic, and
+// everything else is static
+void add_body(state_t *state, body_t *body, collision_filter_t filter,
+              body_kind_t kind) {
+  body_set_kind(body, kind);
+  body_set_filter(body, filter);
+  scene_add_body(state->scene, body);
+}
+
+// the broadphase the level's collision groups find the spirit's candidates
+// with; the state is looked up when the query runs, since the scene is
+// replaced with each level
+list_t *query_nearby_bodies(void *state, body_t *body,
+                            collision_filter_t filter) {
+  return scene_query_body(((state_t *)state)->scene, body, filter);
+}
+
 void init_bgd_player(state_t *state) {
   state->time = 0;
   asset_make_image(BACKGROUND_PATH, BACKGROUND_BOX);
@@ -331,7 +461,9 @@ void init_bgd_player(state_t *state) {
   body_set_centroid(spirit, START_POS);
   // state->spirit = spirit;
   state->collision_type = NO_COLLISION;
-  scene_add_body(state->scene, spirit);
+  // the spirit falls fast enough to pass through a thin platform in one tick
+  body_set_continuous(spirit, true);
+  add_body(state, spirit, SPIRIT_FILTER, BODY_DYNAMIC);
 
   // spirit
   asset_make_spirit(SPIRIT_FRONT_PATH, SPIRIT_LEFT_PATH, SPIRIT_RIGHT_PATH,
@@ -340,12 +472,44 @@ void init_bgd_player(state_t *state) {
 
 // LEVEL INITIALIZATIONS
 
+// the groups of bodies every level tests the spirit against, each with one
+// force creator and handler
+typedef struct {
+  collision_group_t *platforms;
+  collision_group_t *hazards;
+  collision_group_t *gems;
+  collision_group_t *exits;
+} level_groups_t;
+
+level_groups_t make_level_groups(state_t *state) {
+  body_t *spirit = scene_get_body(state->scene, 0);
+  level_groups_t groups = {
+      .platforms = create_group_collision(state->scene, spirit,
+                                          platform_handler, NULL, 0, NULL),
+      .hazards = create_group_collision(state->scene, spirit, lose_handler,
+                                        NULL, 0, NULL),
+      .gems = create_group_collision(state->scene, spirit, gem_user_handler,
+                                     state, 0, NULL),
+      .exits = create_group_collision(state->scene, spirit, win_handler, NULL,
+                                      0, NULL)};
+  collision_group_set_broadphase(groups.platforms, query_nearby_bodies, state,
+                                 SPIRIT_SOLID_QUERY);
+  collision_group_set_broadphase(groups.hazards, query_nearby_bodies, state,
+                                 SPIRIT_HAZARD_QUERY);
+  collision_group_set_broadphase(groups.gems, query_nearby_bodies, state,
+                                 SPIRIT_GEM_QUERY);
+  collision_group_set_broadphase(groups.exits, query_nearby_bodies, state,
+                                 SPIRIT_EXIT_QUERY);
+  return groups;
+}
+
 typedef void (*make_level_t)(state_t *);
 
 void make_level1(state_t *state) {
   state->current_screen = LEVEL1;
   game_over = false;
   init_bgd_player(state);
+  level_groups_t groups = make_level_groups(state);
 
   // make brick platforms
   size_t brick_len = BRICK_NUM[0];
@@ -353,9 +517,8 @@ void make_level1(state_t *state) {
     vector_t coord = (vector_t){BRICKS1[i][0], BRICKS1[i][1]};
     body_t *obstacle =
         make_obstacle(BRICKS1[i][2], BRICKS1[i][3], coord, "platform");
-    scene_add_body(state->scene, obstacle);
-    create_collision(state->scene, scene_get_body(state->scene, 0), obstacle,
-                     platform_handler, NULL, 0, NULL);
+    add_body(state, obstacle, SOLID_FILTER, BODY_STATIC);
+    collision_group_add(groups.platforms, obstacle);
     asset_make_image_with_body(BRICK_PATH, obstacle);
   }
 
@@ -364,9 +527,8 @@ void make_level1(state_t *state) {
   for (size_t i = 0; i < lava_len; i++) {
     vector_t coord = (vector_t){LAVA1[i][0], LAVA1[i][1]};
     body_t *obstacle = make_obstacle(LAVA1[i][2], LAVA1[i][3], coord, "lava");
-    scene_add_body(state->scene, obstacle);
-    create_collision(state->scene, scene_get_body(state->scene, 0), obstacle,
-                     lose_handler, NULL, 0, NULL);
+    add_body(state, obstacle, HAZARD_FILTER, BODY_STATIC);
+    collision_group_add(groups.hazards, obstacle);
     asset_make_anim(LAVA1_PATH, LAVA2_PATH, LAVA3_PATH, obstacle);
   }
 
@@ -376,7 +538,7 @@ void make_level1(state_t *state) {
     vector_t coord = (vector_t){WATER1[i][0], WATER1[i][1]};
     body_t *obstacle =
         make_obstacle(WATER1[i][2], WATER1[i][3], coord, "water");
-    scene_add_body(state->scene, obstacle);
+    add_body(state, obstacle, SCENERY_FILTER, BODY_STATIC);
     asset_make_anim(WATER1_PATH, WATER2_PATH, WATER3_PATH, obstacle);
   }
 
@@ -385,18 +547,16 @@ void make_level1(state_t *state) {
   for (size_t i = 0; i < gem_len; i++) {
     vector_t center = (vector_t){GEM1[i][0], GEM1[i][1]};
     body_t *gem = make_gem(OUTER_RADIUS, INNER_RADIUS, center);
-    scene_add_body(state->scene, gem);
-    create_collision(state->scene, scene_get_body(state->scene, 0), gem,
-                     gem_user_handler, NULL, 0, NULL);
+    add_body(state, gem, GEM_FILTER, BODY_STATIC);
+    collision_group_add(groups.gems, gem);
     asset_make_image_with_body(GEM_PATH, gem);
   }
 
   // make exit
   vector_t coord = (vector_t){EXITS[0][0], EXITS[0][1]};
   body_t *exit = make_obstacle(EXITS[0][2], EXITS[0][3], coord, "exit");
-  scene_add_body(state->scene, exit);
-  create_collision(state->scene, scene_get_body(state->scene, 0), exit,
-                   win_handler, NULL, 0, NULL);
+  add_body(state, exit, EXIT_FILTER, BODY_STATIC);
+  collision_group_add(groups.exits, exit);
   asset_make_image_with_body(EXIT_DOOR_PATH, exit);
 }
 
@@ -404,6 +564,7 @@ void make_level2(state_t *state) {
   state->current_screen = LEVEL2;
   game_over = false;
   init_bgd_player(state);
+  level_groups_t groups = make_level_groups(state);
 
   // make brick platforms
   size_t brick_len = BRICK_NUM[1];
@@ -411,9 +572,8 @@ void make_level2(state_t *state) {
     vector_t coord = (vector_t){BRICKS2[i][0], BRICKS2[i][1]};
     body_t *obstacle =
         make_obstacle(BRICKS2[i][2], BRICKS2[i][3], coord, "platform");
-    scene_add_body(state->scene, obstacle);
-    create_collision(state->scene, scene_get_body(state->scene, 0), obstacle,
-                     platform_handler, NULL, 0, NULL);
+    add_body(state, obstacle, SOLID_FILTER, BODY_STATIC);
+    collision_group_add(groups.platforms, obstacle);
     asset_make_image_with_body(BRICK_PATH, obstacle);
   }
 
@@ -422,9 +582,8 @@ void make_level2(state_t *state) {
   for (size_t i = 0; i < lava_len; i++) {
     vector_t coord = (vector_t){LAVA2[i][0], LAVA2[i][1]};
     body_t *obstacle = make_obstacle(LAVA2[i][2], LAVA2[i][3], coord, "lava");
-    scene_add_body(state->scene, obstacle);
-    create_collision(state->scene, scene_get_body(state->scene, 0), obstacle,
-                     lose_handler, NULL, 0, NULL);
+    add_body(state, obstacle, HAZARD_FILTER, BODY_STATIC);
+    collision_group_add(groups.hazards, obstacle);
     asset_make_anim(LAVA1_PATH, LAVA2_PATH, LAVA3_PATH, obstacle);
   }
 
@@ -434,7 +593,7 @@ void make_level2(state_t *state) {
     vector_t coord = (vector_t){WATER2[i][0], WATER2[i][1]};
     body_t *obstacle =
         make_obstacle(WATER2[i][2], WATER2[i][3], coord, "water");
-    scene_add_body(state->scene, obstacle);
+    add_body(state, obstacle, SCENERY_FILTER, BODY_STATIC);
     asset_make_anim(WATER1_PATH, WATER2_PATH, WATER3_PATH, obstacle);
   }
 
@@ -443,54 +602,48 @@ void make_level2(state_t *state) {
   for (size_t i = 0; i < gem_len; i++) {
     vector_t center = (vector_t){GEM2[i][0], GEM2[i][1]};
     body_t *gem = make_gem(OUTER_RADIUS, INNER_RADIUS, center);
-    scene_add_body(state->scene, gem);
-    create_collision(state->scene, scene_get_body(state->scene, 0), gem,
-                     gem_user_handler, NULL, 0, NULL);
+    add_body(state, gem, GEM_FILTER, BODY_STATIC);
+    collision_group_add(groups.gems, gem);
     asset_make_image_with_body(GEM_PATH, gem);
   }
 
   // make exit
   vector_t coord = (vector_t){EXITS[1][0], EXITS[1][1]};
   body_t *exit = make_obstacle(EXITS[1][2], EXITS[1][3], coord, "exit");
-  scene_add_body(state->scene, exit);
-  create_collision(state->scene, scene_get_body(state->scene, 0), exit,
-                   win_handler, NULL, 0, NULL);
+  add_body(state, exit, EXIT_FILTER, BODY_STATIC);
+  collision_group_add(groups.exits, exit);
   asset_make_image_with_body(EXIT_DOOR_PATH, exit);
 
   // make elevator
   vector_t e_coord = (vector_t){ELEVATORS[0][0], ELEVATORS[0][1]};
   body_t *elevator =
       make_obstacle(ELEVATORS[0][2], ELEVATORS[0][3], e_coord, "elevator");
-  scene_add_body(state->scene, elevator);
-  create_collision(state->scene, scene_get_body(state->scene, 0), elevator,
-                   platform_handler, NULL, 0, NULL);
+  add_body(state, elevator, SOLID_FILTER, BODY_KINEMATIC);
+  collision_group_add(groups.platforms, elevator);
   asset_make_image_with_body(ELEVATOR_PATH, elevator);
 
   // make elevator button
   vector_t e_button_coord = (vector_t){E_BUTTONS[0][0], E_BUTTONS[0][1]};
   body_t *e_button = make_obstacle(E_BUTTONS[0][2], E_BUTTONS[0][3],
                                    e_button_coord, "elevator button");
-  scene_add_body(state->scene, e_button);
-  create_collision(state->scene, scene_get_body(state->scene, 0), e_button,
-                   platform_handler, NULL, 0, NULL);
+  add_body(state, e_button, SOLID_FILTER, BODY_STATIC);
+  collision_group_add(groups.platforms, e_button);
   asset_make_button(ELEVATOR_BUTTON_UNPRESSED_PATH,
                     ELEVATOR_BUTTON_PRESSED_PATH, e_button);
 
   // make door
   vector_t door_coord = (vector_t){DOORS[0][0], DOORS[0][1]};
   body_t *door = make_obstacle(DOORS[0][2], DOORS[0][3], door_coord, "door");
-  scene_add_body(state->scene, door);
-  create_collision(state->scene, scene_get_body(state->scene, 0), door,
-                   platform_handler, NULL, 0, NULL);
+  add_body(state, door, SOLID_FILTER, BODY_STATIC);
+  collision_group_add(groups.platforms, door);
   asset_make_image_with_body(DOOR_PATH, door);
 
   // make door button
   vector_t button_coord = (vector_t){BUTTONS[0][0], BUTTONS[0][1]};
   body_t *button =
       make_obstacle(BUTTONS[0][2], BUTTONS[0][3], button_coord, "door button");
-  scene_add_body(state->scene, button);
-  create_collision(state->scene, scene_get_body(state->scene, 0), button,
-                   platform_handler, NULL, 0, NULL);
+  add_body(state, button, SOLID_FILTER, BODY_STATIC);
+  collision_group_add(groups.platforms, button);
   asset_make_button(DOOR_BUTTON_UNPRESSED_PATH, DOOR_BUTTON_PRESSED_PATH,
                     button);
 }
@@ -499,14 +652,14 @@ void make_level3(state_t *state) {
   state->current_screen = LEVEL3;
   game_over = false;
   init_bgd_player(state);
+  level_groups_t groups = make_level_groups(state);
 
   for (size_t i = 1; i < 3; i++) {
     vector_t elevator_coord = (vector_t){ELEVATORS[i][0], ELEVATORS[i][1]};
     body_t *obstacle = make_obstacle(ELEVATORS[i][2], ELEVATORS[i][3],
                                      elevator_coord, "elevator");
-    scene_add_body(state->scene, obstacle);
-    create_collision(state->scene, scene_get_body(state->scene, 0), obstacle,
-                     platform_handler, NULL, 0, NULL);
+    add_body(state, obstacle, SOLID_FILTER, BODY_KINEMATIC);
+    collision_group_add(groups.platforms, obstacle);
     asset_make_image_with_body(ELEVATOR_PATH, obstacle);
   }
 
@@ -514,27 +667,24 @@ void make_level3(state_t *state) {
   vector_t e_button_coord = (vector_t){E_BUTTONS[1][0], E_BUTTONS[1][1]};
   body_t *e_button = make_obstacle(E_BUTTONS[1][2], E_BUTTONS[1][3],
                                    e_button_coord, "elevator button");
-  scene_add_body(state->scene, e_button);
-  create_collision(state->scene, scene_get_body(state->scene, 0), e_button,
-                   platform_handler, NULL, 0, NULL);
+  add_body(state, e_button, SOLID_FILTER, BODY_STATIC);
+  collision_group_add(groups.platforms, e_button);
   asset_make_button(ELEVATOR_BUTTON_UNPRESSED_PATH,
                     ELEVATOR_BUTTON_PRESSED_PATH, e_button);
 
   // make door
   vector_t door_coord = (vector_t){DOORS[1][0], DOORS[1][1]};
   body_t *door = make_obstacle(DOORS[1][2], DOORS[1][3], door_coord, "door");
-  scene_add_body(state->scene, door);
-  create_collision(state->scene, scene_get_body(state->scene, 0), door,
-                   platform_handler, NULL, 0, NULL);
+  add_body(state, door, SOLID_FILTER, BODY_STATIC);
+  collision_group_add(groups.platforms, door);
   asset_make_image_with_body(DOOR_PATH, door);
 
   // make door button
   vector_t button_coord = (vector_t){BUTTONS[1][0], BUTTONS[1][1]};
   body_t *button =
       make_obstacle(BUTTONS[1][2], BUTTONS[1][3], button_coord, "door button");
-  scene_add_body(state->scene, button);
-  create_collision(state->scene, scene_get_body(state->scene, 0), button,
-                   platform_handler, NULL, 0, NULL);
+  add_body(state, button, SOLID_FILTER, BODY_STATIC);
+  collision_group_add(groups.platforms, button);
   asset_make_button(DOOR_BUTTON_UNPRESSED_PATH, DOOR_BUTTON_PRESSED_PATH,
                     button);
 
@@ -543,9 +693,8 @@ void make_level3(state_t *state) {
     vector_t coord = (vector_t){BRICKS3[i][0], BRICKS3[i][1]};
     body_t *obstacle =
         make_obstacle(BRICKS3[i][2], BRICKS3[i][3], coord, "platform");
-    scene_add_body(state->scene, obstacle);
-    create_collision(state->scene, scene_get_body(state->scene, 0), obstacle,
-                     platform_handler, NULL, 0, NULL);
+    add_body(state, obstacle, SOLID_FILTER, BODY_STATIC);
+    collision_group_add(groups.platforms, obstacle);
     asset_make_image_with_body(BRICK_PATH, obstacle);
   }
 
@@ -553,9 +702,8 @@ void make_level3(state_t *state) {
   for (size_t i = 0; i < lava_len; i++) {
     vector_t coord = (vector_t){LAVA3[i][0], LAVA3[i][1]};
     body_t *obstacle = make_obstacle(LAVA3[i][2], LAVA3[i][3], coord, "lava");
-    scene_add_body(state->scene, obstacle);
-    create_collision(state->scene, scene_get_body(state->scene, 0), obstacle,
-                     lose_handler, NULL, 0, NULL);
+    add_body(state, obstacle, HAZARD_FILTER, BODY_STATIC);
+    collision_group_add(groups.hazards, obstacle);
     asset_make_anim(LAVA1_PATH, LAVA2_PATH, LAVA3_PATH, obstacle);
   }
 
@@ -564,7 +712,7 @@ void make_level3(state_t *state) {
     vector_t coord = (vector_t){WATER3[i][0], WATER3[i][1]};
     body_t *obstacle =
         make_obstacle(WATER3[i][2], WATER3[i][3], coord, "water");
-    scene_add_body(state->scene, obstacle);
+    add_body(state, obstacle, SCENERY_FILTER, BODY_STATIC);
     asset_make_anim(WATER1_PATH, WATER2_PATH, WATER3_PATH, obstacle);
   }
 
@@ -572,30 +720,41 @@ void make_level3(state_t *state) {
   for (size_t i = 0; i < gem_len; i++) {
     vector_t center = (vector_t){GEM3[i][0], GEM3[i][1]};
     body_t *gem = make_gem(OUTER_RADIUS, INNER_RADIUS, center);
-    scene_add_body(state->scene, gem);
-    create_collision(state->scene, scene_get_body(state->scene, 0), gem,
-                     gem_user_handler, NULL, 0, NULL);
+    add_body(state, gem, GEM_FILTER, BODY_STATIC);
+    collision_group_add(groups.gems, gem);
     asset_make_image_with_body(GEM_PATH, gem);
   }
 
   // make exit
   vector_t coord = (vector_t){EXITS[2][0], EXITS[2][1]};
   body_t *exit = make_obstacle(EXITS[2][2], EXITS[2][3], coord, "exit");
-  scene_add_body(state->scene, exit);
-  create_collision(state->scene, scene_get_body(state->scene, 0), exit,
-                   win_handler, NULL, 0, NULL);
+  add_body(state, exit, EXIT_FILTER, BODY_STATIC);
+  collision_group_add(groups.exits, exit);
   asset_make_image_with_body(EXIT_DOOR_PATH, exit);
 }
 
 // SCREEN-SWITCHING FUNCTIONALITY
 
+void reset_scene(state_t *state) {
+  list_free(state->removed_bodies);
+  collision_cache_free(state->collision_cache);
+  contact_table_free(state->button_contacts);
+  scene_free(state->scene);
+  state->scene = scene_init();
+  scene_set_sleeping(state->scene, SLEEP_SPEED, SLEEP_TICKS);
+  scene_set_broadphase(state->scene, GRID_CELL_SIZE);
+  state->removed_bodies = list_init(1, NULL);
+  state->collision_cache = collision_cache_init();
+  state->button_contacts = contact_table_init();
+}
+
 void go_to_level(state_t *state, screen_t target_screen,
                  make_level_t make_level) {
   asset_reset_asset_list();
-  scene_free(state->scene);
-  state->scene = scene_init();
+  reset_scene(state);
   state->current_screen = target_screen;
   state->elevator = false;
+  state->accumulator = 0;
   sdl_reset_timer();
   make_level(state);
 }
@@ -609,8 +768,7 @@ void go_to_level3(state_t *state) { go_to_level(state, LEVEL3, make_level3); }
 void go_to_homepage(state_t *state) {
   if (state->current_screen != HOMEPAGE) {
     asset_reset_asset_list();
-    scene_free(state->scene);
-    state->scene = scene_init();
+    reset_scene(state);
   }
   state->current_screen = HOMEPAGE;
   state->pause = false;
@@ -765,11 +923,14 @@ void button_action(state_t *state, body_t *button) {
     asset_t *asset = list_get(asset_list, i);
     if (asset->type == ASSET_IMAGE) {
       image_asset_t *obstacle = (image_asset_t *)asset;
-      body_t *body = obstacle->body;
+      body_t *body = body_handle_resolve(obstacle->body);
+      // a door removed earlier this tick is only revoked once it is freed
+      if (body == NULL || body_is_removed(body)) {
+        continue;
+      }
       if ((strcmp(body_get_info(button), "door button") == 0 &&
            strcmp(body_get_info(body), "door") == 0)) {
-        asset_remove_body(body);
-        body_remove(body);
+        remove_body(state, body);
         break;
       } else if (strcmp(body_get_info(button), "elevator button") == 0 &&
                  strcmp(body_get_info(body), "elevator") == 0) {
@@ -779,17 +940,53 @@ void button_action(state_t *state, body_t *button) {
   }
 }
 
+// presses the buttons the spirit has just stepped onto
 void button_press(state_t *state) {
   body_t *spirit = scene_get_body(state->scene, 0);
   list_t *asset_list = asset_get_asset_list();
-  for (size_t i = 0; i < list_size(asset_list); i++) {
+  size_t num_assets = list_size(asset_list);
+  if (num_assets == 0) {
+    return;
+  }
+
+  button_asset_t *button_assets[num_assets];
+  body_t *buttons[num_assets];
+  size_t num_buttons = 0;
+  for (size_t i = 0; i < num_assets; i++) {
     asset_t *asset = list_get(asset_list, i);
     if (asset->type == ASSET_BUTTON) {
       button_asset_t *button_asset = (button_asset_t *)asset;
-      body_t *button = button_asset->body;
-      if (find_collision(spirit, button).collided) {
-        asset_change_texture_button((asset_t *)button_asset);
+      body_t *button = body_handle_resolve(button_asset->body);
+      if (button != NULL) {
+        button_assets[num_buttons] = button_asset;
+        buttons[num_buttons] = button;
+        num_buttons++;
+      }
+    }
+  }
+
+  // test every button at once, before any button action changes the assets
+  collision_hit_t hits[num_assets];
+  size_t num_hits = find_collisions(state->collision_cache, spirit, buttons,
+                                    num_buttons, hits);
+  for (size_t i = 0; i < num_hits; i++) {
+    contact_table_report(state->button_contacts, spirit,
+                         buttons[hits[i].index], hits[i].axis);
+  }
+
+  // a button only acts when the spirit first lands on it
+  const contact_event_t *events;
+  size_t num_events = contact_table_update(state->button_contacts, &events);
+  for (size_t i = 0; i < num_events; i++) {
+    body_t *button = body_handle_resolve(events[i].body2);
+    if (events[i].type != CONTACT_BEGIN || button == NULL) {
+      continue;
+    }
+    for (size_t j = 0; j < num_buttons; j++) {
+      if (buttons[j] == button) {
+        asset_change_texture_button((asset_t *)button_assets[j]);
         button_action(state, button);
+        break;
       }
     }
   }
@@ -838,7 +1035,8 @@ void move_elevator(state_t *state) {
         }
       }
 
-      if (find_collision(body, spirit).collided &&
+      if (find_collision_cached(state->collision_cache, body, spirit)
+              .collided &&
           (state->collision_type == UP_COLLISION ||
            state->collision_type == UP_LEFT_COLLISION ||
            state->collision_type == UP_RIGHT_COLLISION)) {
@@ -860,8 +1058,8 @@ void update_points(state_t *state) {
     asset_t *asset = list_get(asset_list, i);
     if (asset->type == ASSET_IMAGE) {
       image_asset_t *gem_asset = (image_asset_t *)asset;
-      body_t *gem = gem_asset->body;
-      if (strcmp(body_get_info(gem), "gem") == 0) {
+      body_t *gem = body_handle_resolve(gem_asset->body);
+      if (gem != NULL && strcmp(body_get_info(gem), "gem") == 0) {
         gem_counter--;
       }
     }
@@ -875,71 +1073,56 @@ void update_points(state_t *state) {
   }
 }
 
+// tests the spirit against every body in a list in one batch, returning the
+// bodies it collides with in a new list that does not own them
+list_t *find_spirit_collisions(state_t *state, list_t *bodies) {
+  body_t *spirit = scene_get_body(state->scene, 0);
+  list_t *colliding = list_init(1, NULL);
+  size_t count = list_size(bodies);
+  if (count == 0) {
+    return colliding;
+  }
+
+  body_t *candidates[count];
+  collision_hit_t hits[count];
+  for (size_t i = 0; i < count; i++) {
+    candidates[i] = list_get(bodies, i);
+  }
+  size_t num_hits = find_collisions(state->collision_cache, spirit, candidates,
+                                    count, hits);
+  for (size_t i = 0; i < num_hits; i++) {
+    list_add(colliding, candidates[hits[i].index]);
+  }
+  return colliding;
+}
+
 // to check if the levels have been completed or not
 void level_complete(state_t *state) {
   body_t *spirit = scene_get_body(state->scene, 0);
-  list_t *asset_list = asset_get_asset_list();
-  for (size_t i = 0; i < list_size(asset_list); i++) {
-    asset_t *asset = list_get(asset_list, i);
-    if (asset->type == ASSET_IMAGE) {
-      image_asset_t *obstacle = (image_asset_t *)asset;
-      body_t *body = obstacle->body;
-      if ((strcmp(body_get_info(body), "exit")) == 0 &&
-          find_collision(spirit, body).collided) {
-        state->level_completed[state->current_screen - 1] = true;
-      }
-    }
+  list_t *nearby = scene_query_body(state->scene, spirit, SPIRIT_EXIT_QUERY);
+  list_t *touching = find_spirit_collisions(state, nearby);
+  if (list_size(touching) > 0) {
+    state->level_completed[state->current_screen - 1] = true;
   }
+  list_free(touching);
+  list_free(nearby);
 }
 
 collision_type_t collision(state_t *state) {
   body_t *spirit = scene_get_body(state->scene, 0);
-  scene_t *scene = state->scene;
   collision_type_t res = NO_COLLISION;
 
-  for (size_t i = 1; i < scene_bodies(scene); i++) {
-    body_t *platform = scene_get_body(scene, i);
-
-    if ((strcmp(body_get_info(platform), "platform") != 0) &&
-        (strcmp(body_get_info(platform), "elevator") != 0) &&
-        (strcmp(body_get_info(platform), "door") != 0) &&
-        (strcmp(body_get_info(platform), "door button") != 0) &&
-        (strcmp(body_get_info(platform), "elevator button") != 0)) {
-      continue;
-    }
-
-    if (!find_collision(spirit, platform).collided) {
-      continue;
-    }
-
-    vector_t cen = body_get_centroid(spirit);
-    list_t *pts = body_get_shape(platform);
-    vector_t *v1 = list_get(pts, 0); // bottom left
-    vector_t *v2 = list_get(pts, 1); // bottom right
-    vector_t *v3 = list_get(pts, 2); // top right
-    vector_t *v4 = list_get(pts, 3); // top left
-
-    if (cen.x > v4->x - INNER_RADIUS && cen.x < v3->x + INNER_RADIUS &&
-        cen.y - (INNER_RADIUS - 8) >= v4->y) {
-      res += UP_COLLISION;
-      continue;
-    }
-    if (cen.x > v1->x - INNER_RADIUS && cen.x < v2->x + INNER_RADIUS &&
-        cen.y < v1->y) {
-      res += DOWN_COLLISION;
-      continue;
-    }
-    if (cen.y > v1->y - OUTER_RADIUS && cen.y < v4->y + OUTER_RADIUS &&
-        cen.x < v1->x) {
-      res += LEFT_COLLISION;
-      continue;
-    }
-    if (cen.y > v2->y - OUTER_RADIUS && cen.y < v3->y + OUTER_RADIUS &&
-        cen.x > v2->x) {
-      res += RIGHT_COLLISION;
-      continue;
-    }
+  // only solid bodies whose bounding boxes overlap the spirit's can be
+  // touching it
+  list_t *nearby = scene_query_body(state->scene, spirit, SPIRIT_SOLID_QUERY);
+  list_t *touching = find_spirit_collisions(state, nearby);
+  vector_t cen = body_get_centroid(spirit);
+  for (size_t i = 0; i < list_size(touching); i++) {
+    body_t *platform = list_get(touching, i);
+    res += get_contact_face(cen, platform);
   }
+  list_free(touching);
+  list_free(nearby);
   return res;
 }
 
@@ -948,6 +1131,11 @@ state_t *emscripten_init() {
   sdl_init(MIN, MAX);
   state_t *state = malloc(sizeof(state_t));
   state->scene = scene_init();
+  scene_set_sleeping(state->scene, SLEEP_SPEED, SLEEP_TICKS);
+  scene_set_broadphase(state->scene, GRID_CELL_SIZE);
+  state->removed_bodies = list_init(1, NULL);
+  state->collision_cache = collision_cache_init();
+  state->button_contacts = contact_table_init();
   state->current_screen = HOMEPAGE;
   state->collision_type = NO_COLLISION;
   state->pause = false;
@@ -959,6 +1147,7 @@ state_t *emscripten_init() {
   }
 
   state->time = 0;
+  state->accumulator = 0;
   state->font = TTF_OpenFont(FONT_FILEPATH, 18);
 
   go_to_homepage(state);
@@ -966,55 +1155,70 @@ state_t *emscripten_init() {
   return state;
 }
 
-bool emscripten_main(state_t *state) {
-  sdl_clear();
-  sdl_render_scene(state->scene);
-  sdl_play_music(BACKGROUND_MUSIC_PATH);
-  list_t *body_assets = asset_get_asset_list();
-  size_t len = list_size(body_assets);
-
-  for (size_t i = 0; i < len; i++) {
-    asset_t *asset = list_get(body_assets, i);
-    asset_animate(asset, state->time);
-    asset_animate(asset, state->time);
-    asset_render(list_get(body_assets, i));
-  }
-
-  if (state->current_screen != HOMEPAGE) {
-    double dt = time_since_last_tick();
-    if (!(state->pause) && !(game_over) && dt < 0.1) {
-
-      // timer
-      char text[10000];
-      sprintf(text, "Clock:%.0f", floor(state->time));
-      vector_t text_dim = get_dimensions_for_text(text);
-      SDL_Rect rect = (SDL_Rect){.x = CLOCK_POS.x - (text_dim.x / 2),
-                                 .y = CLOCK_POS.y,
-                                 .w = text_dim.x,
-                                 .h = text_dim.y};
+// advances the level by one tick of the given length
+void tick(state_t *state, double dt) {
+  state->collision_type = collision(state);
 
-      sdl_render_text(text, state->font, CLOCK_COL, &rect);
-      state->collision_type = collision(state);
+  // gravity
+  apply_gravity(state, dt);
 
-      // gravity
-      apply_gravity(state, dt);
+  // check for pressed buttons
+  button_press(state);
 
-      // check for pressed buttons
-      button_press(state);
+  if (state->elevator) {
+    move_elevator(state);
+  }
 
-      if (state->elevator) {
-        move_elevator(state);
-      }
+  // check for completed level
+  level_complete(state);
 
-      // check for completed level
-      level_complete(state);
+  update_points(state);
 
-      update_points(state);
+  scene_tick(state->scene, dt);
+  forget_removed_bodies(state);
+  state->time += dt;
+}
 
-      scene_tick(state->scene, dt);
-      state->time += dt;
+bool emscripten_main(state_t *state) {
+  // bodies are drawn where they are unless a level is being played
+  sdl_set_interpolation(1);
+  bool playing = state->current_screen != HOMEPAGE && !(state->pause) &&
+                 !(game_over);
+  if (state->current_screen != HOMEPAGE) {
+    double frame_time = fmin(time_since_last_tick(), MAX_TICK_TIME);
+    if (playing) {
+      // run as many whole ticks as real time has passed, and carry the rest
+      // over to the next frame
+      state->accumulator += frame_time;
+      while (state->accumulator >= FIXED_TICK_TIME && !(game_over)) {
+        tick(state, FIXED_TICK_TIME);
+        state->accumulator -= FIXED_TICK_TIME;
+      }
+      // the spirit is moved off screen when a level ends, so there is
+      // nothing to draw it between
+      if (!(game_over)) {
+        sdl_set_interpolation(state->accumulator / FIXED_TICK_TIME);
+      }
     }
   }
+
+  sdl_clear();
+  sdl_render_scene(state->scene);
+  sdl_play_music(BACKGROUND_MUSIC_PATH);
+  asset_render_all(state->time);
+
+  if (playing && !(game_over)) {
+    // timer
+    char text[10000];
+    sprintf(text, "Clock:%.0f", floor(state->time));
+    vector_t text_dim = get_dimensions_for_text(text);
+    SDL_Rect rect = (SDL_Rect){.x = CLOCK_POS.x - (text_dim.x / 2),
+                               .y = CLOCK_POS.y,
+                               .w = text_dim.x,
+                               .h = text_dim.y};
+
+    sdl_render_text(text, state->font, CLOCK_COL, &rect);
+  }
   sdl_show();
   return false;
 }
@@ -1022,7 +1226,11 @@ bool emscripten_main(state_t *state) {
 void emscripten_free(state_t *state) {
   sdl_quit();
   list_free(asset_get_asset_list());
+  list_free(state->removed_bodies);
+  collision_cache_free(state->collision_cache);
+  contact_table_free(state->button_contacts);
   scene_free(state->scene);
+  body_handle_destroy();
   asset_cache_destroy();
   TTF_CloseFont(state->font);
   free(state);
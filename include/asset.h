@@ -8,6 +8,7 @@
 #include <stddef.h>
 
 #include "body.h"
+#include "body_handle.h"
 
 typedef enum {
   ASSET_IMAGE,
@@ -32,7 +33,7 @@ typedef struct text_asset {
 typedef struct image_asset {
   asset_t base;
   SDL_Texture *texture;
-  body_t *body;
+  body_handle_t body;
 } image_asset_t;
 
 typedef struct spirit_asset {
@@ -41,7 +42,7 @@ typedef struct spirit_asset {
   SDL_Texture *front_texture;
   SDL_Texture *right_texture;
   SDL_Texture *left_texture;
-  body_t *body;
+  body_handle_t body;
 } spirit_asset_t;
 
 typedef struct anim_asset {
@@ -50,7 +51,7 @@ typedef struct anim_asset {
   SDL_Texture *frame1_texture;
   SDL_Texture *frame2_texture;
   SDL_Texture *frame3_texture;
-  body_t *body;
+  body_handle_t body;
 } anim_asset_t;
 
 typedef struct button_asset {
@@ -58,7 +59,7 @@ typedef struct button_asset {
   SDL_Texture *curr_texture;
   SDL_Texture *unpressed_texture;
   SDL_Texture *pressed_texture;
-  body_t *body;
+  body_handle_t body;
 } button_asset_t;
 
 /**
@@ -75,6 +76,10 @@ void asset_make_image(const char *filepath, SDL_Rect bounding_box);
  * Allocates memory for an image asset with an attached body and adds it
  * to the internal asset list. When the asset is rendered, the image will be
  * rendered on top of the body.
+ * The asset holds a handle to the body rather than the body itself, so once
+ * the body is revoked with body_handle_revoke() the asset is no longer
+ * rendered and its handle resolves to NULL. The asset is freed by the next
+ * asset_render_all().
  *
  * @param filepath the filepath to the image file
  * @param body the body to render the image on top of
@@ -167,21 +172,21 @@ void asset_change_texture_button(asset_t *asset);
  */
 list_t *asset_get_asset_list();
 
-/**
- * Removes and destroys all image assets associated with the given body.
- * This is typically called when a body is destroyed to clean up its visual
- * representation.
- *
- * @param body the body whose associated assets should be removed
- */
-void asset_remove_body(body_t *body);
-
 /**
  * Renders the asset to the screen.
  * @param asset the asset to render
  */
 void asset_render(asset_t *asset);
 
+/**
+ * Animates and renders every asset in the internal asset list, in order.
+ * Assets whose bodies have been revoked are destroyed and removed from the
+ * list instead, keeping the other assets in order.
+ *
+ * @param time the time to animate the assets at, in seconds
+ */
+void asset_render_all(double time);
+
 /**
  * Frees the memory allocated for the asset.
  * @param asset the asset to free
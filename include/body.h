@@ -2,9 +2,11 @@
 #define __BODY_H__
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "color.h"
 #include "list.h"
+#include "local_shape.h"
 #include "vector.h"
 
 /**
@@ -13,6 +15,31 @@
  */
 typedef struct body body_t;
 
+/**
+ * How a body moves.
+ * A dynamic body is moved by its velocity and by the forces and impulses
+ * applied to it. A kinematic body only moves at the velocity it is given,
+ * like a moving platform. A static body never moves unless its centroid is
+ * set, and its velocity stays zero.
+ * Only dynamic bodies fall asleep (see body_store_set_sleeping()).
+ */
+typedef enum { BODY_DYNAMIC, BODY_KINEMATIC, BODY_STATIC } body_kind_t;
+
+/**
+ * Which collision layers a body belongs to, and which layers it can collide
+ * with. Each field is a bit set of up to 32 layers, whose meanings are up to
+ * the game.
+ */
+typedef struct {
+  /** The layers the body belongs to */
+  uint32_t layer;
+  /** The layers of the bodies the body can collide with */
+  uint32_t mask;
+} collision_filter_t;
+
+/** A filter that belongs to, and collides with, every layer */
+extern const collision_filter_t COLLISION_FILTER_ALL;
+
 /**
  * Initializes a body without any info.
  * Acts like body_init_with_info() where info and info_freer are NULL.
@@ -27,7 +54,8 @@ body_t *body_init(list_t *shape, double mass, color_t color);
  * Asserts that the required memory is allocated.
  *
  * @param shape a list of vectors describing the initial shape of the body
- * @param mass the mass of the body (if INFINITY, stops the body from moving)
+ * @param mass the mass of the body (if INFINITY or __DBL_MAX__, forces and
+ *   impulses never move the body)
  * @param color the color of the body, used to draw it on the screen
  * @param info additional information to associate with the body,
  *   e.g. its type if the scene has multiple types of bodies
@@ -46,6 +74,64 @@ body_t *body_init_with_info(list_t *shape, double mass, color_t color,
  */
 list_t *body_get_shape(body_t *body);
 
+/**
+ * Gets the vertices of a body relative to its centroid, before it is rotated.
+ * Unlike body_get_shape(), this borrows the body's own array, so it does not
+ * allocate any memory. The array is valid until the body is freed.
+ *
+ * @param body the pointer to the body
+ * @param size set to the number of vertices
+ * @return an array of the vertices
+ */
+const vector_t *body_get_local_vertices(body_t *body, size_t *size);
+
+/**
+ * Records that a body was built from a shared local shape, placed at the
+ * body's centroid and turned by its rotation, e.g. with local_shape_place().
+ * From then on the body's world-space vertices are placed from the shared
+ * shape, and while it is unrotated its normals are the shared shape's own
+ * (see shape_view_get()).
+ * The body takes its own reference to the shape, which it releases when it
+ * is freed.
+ *
+ * @param body the pointer to the body
+ * @param shape the shape the body was built from, with as many vertices as
+ *   the body
+ */
+void body_set_local_shape(body_t *body, local_shape_t *shape);
+
+/**
+ * Gets the shared local shape a body was built from.
+ *
+ * @param body the pointer to the body
+ * @return the shape given to body_set_local_shape(), or NULL if there is none
+ */
+local_shape_t *body_get_local_shape(body_t *body);
+
+/**
+ * The world-space vertices, edge normals, bounds and kind of a body's shape,
+ * which shape_view_get() (see shape_view.h) caches on the body. Freed along
+ * with the body, so nothing outlives it.
+ */
+typedef struct shape_cache shape_cache_t;
+
+/**
+ * Gets the shape cache kept on a body.
+ *
+ * @param body the pointer to the body
+ * @return the body's cache, or NULL if its shape has not been viewed yet
+ */
+shape_cache_t *body_get_shape_cache(body_t *body);
+
+/**
+ * Keeps a shape cache on a body, taking ownership of it. The cache is freed
+ * with shape_cache_free() when the body is freed.
+ *
+ * @param body the pointer to the body, which must not have a cache yet
+ * @param cache the cache to keep
+ */
+void body_set_shape_cache(body_t *body, shape_cache_t *cache);
+
 /**
  * Return the info associated with a body.
  *
@@ -63,8 +149,21 @@ void *body_get_info(body_t *body);
 vector_t body_get_centroid(body_t *body);
 
 /**
- * Translates a body to a new position.
+ * Gets where a body's center of mass was before the last tick that moved it,
+ * e.g. to draw the body part of the way between two ticks.
+ * A body that is not moving, or stops moving, is treated as having been
+ * where it is all along.
+ *
+ * @param body the pointer to the body
+ * @return the body's previous center of mass
+ */
+vector_t body_get_previous_centroid(body_t *body);
+
+/**
+ * Translates a body to a new position, waking it.
  * The position is specified by the position of the body's center of mass.
+ * A body that is not moving is also treated as having been there before the
+ * last tick; a moving body keeps the previous centroid its last tick saved.
  *
  * @param body the pointer to the body
  * @param x the body's new centroid
@@ -81,12 +180,93 @@ vector_t body_get_velocity(body_t *body);
 
 /**
  * Changes a body's velocity (the time-derivative of its position).
+ * A non-zero velocity wakes the body. Does nothing to a static body.
  *
  * @param body the pointer to the body
  * @param v the body's new velocity
  */
 void body_set_velocity(body_t *body, vector_t v);
 
+/**
+ * Gets how a body moves. Bodies are dynamic until they are given a kind.
+ *
+ * @param body the pointer to the body
+ * @return the body's kind
+ */
+body_kind_t body_get_kind(body_t *body);
+
+/**
+ * Changes how a body moves.
+ * Clears the forces and impulses applied to the body and wakes it.
+ * Making it static also sets its velocity to zero.
+ *
+ * @param body the pointer to the body
+ * @param kind the body's new kind
+ */
+void body_set_kind(body_t *body, body_kind_t kind);
+
+/**
+ * Gets the collision layers a body belongs to and collides with.
+ * Bodies have COLLISION_FILTER_ALL until they are given a filter.
+ *
+ * @param body the pointer to the body
+ * @return the body's filter
+ */
+collision_filter_t body_get_filter(body_t *body);
+
+/**
+ * Changes the collision layers a body belongs to and collides with.
+ * A scene's broadphase files the body under the filter it has when it is
+ * added to the scene (see scene_set_broadphase()), so give the body its
+ * filter before adding it.
+ *
+ * @param body the pointer to the body
+ * @param filter the body's new filter
+ */
+void body_set_filter(body_t *body, collision_filter_t filter);
+
+/**
+ * Returns whether a body is asleep. A sleeping body is not moved by ticks
+ * and has no velocity.
+ * It wakes when it is given a non-zero velocity, force or impulse, when its
+ * centroid or kind is set, or when body_wake() is called. Bodies that move
+ * into a sleeping body do not wake it.
+ *
+ * @param body the pointer to the body
+ * @return whether the body is asleep
+ */
+bool body_is_sleeping(body_t *body);
+
+/**
+ * Wakes a sleeping body, e.g. when something it rests on starts to move.
+ * Does nothing to a body that is awake.
+ *
+ * @param body the pointer to the body
+ */
+void body_wake(body_t *body);
+
+/**
+ * Sets whether a scene stops a body at the first body in its path that it
+ * would otherwise pass all the way through in one tick, e.g. a small, fast
+ * body falling onto a thin platform. Only bodies that the body's filter
+ * collides with stop it, and only in a scene with a broadphase (see
+ * scene_set_broadphase()).
+ * Bodies are not continuous until this is called.
+ *
+ * @param body the pointer to the body
+ * @param continuous whether the body should be stopped from tunneling
+ */
+void body_set_continuous(body_t *body, bool continuous);
+
+/**
+ * Returns whether a scene stops a body from tunneling (see
+ * body_set_continuous()).
+ *
+ * @param body the pointer to the body
+ * @return whether the body is continuous
+ */
+bool body_is_continuous(body_t *body);
+
 /**
  * Returns a body's area.
  * See https://en.wikipedia.org/wiki/Shoelace_formula#Statement.
@@ -130,13 +310,26 @@ double body_get_rotation(body_t *body);
  */
 void body_set_rotation(body_t *body, double angle);
 
+/**
+ * Gets a number that changes whenever a body's centroid or rotation does,
+ * whether it is set or moved by a tick, or when it is given a local shape,
+ * so anything derived from the body's shape can be kept until the version
+ * changes.
+ * Versions are never reused, even by bodies allocated after others are freed.
+ *
+ * @param body the pointer to the body
+ * @return the body's version
+ */
+uint64_t body_get_version(body_t *body);
+
 /**
  * Updates the body after a given time interval has elapsed.
  * Sets acceleration and velocity according to the forces and impulses
  * applied to the body during the tick.
  * The body is translated at the *average* of the velocities before
  * and after the tick.
- * Resets the forces and impulses accumulated on the body.
+ * Resets the forces and impulses accumulated on the body, and saves where it
+ * was as its previous centroid.
  *
  * @param body the body to tick
  * @param dt the number of seconds elapsed since the last tick
@@ -154,6 +347,7 @@ double body_get_mass(body_t *body);
 /**
  * Applies a force to a body over the current tick.
  * If multiple forces are applied in the same tick, they are added.
+ * A non-zero force wakes the body.
  * Does not change the body's position or velocity; see body_tick().
  *
  * @param body the pointer to the body
@@ -166,6 +360,7 @@ void body_add_force(body_t *body, vector_t force);
  * An impulse causes an instantaneous change in velocity,
  * which is useful for modeling collisions.
  * If multiple impulses are applied in the same tick, they are added.
+ * A non-zero impulse wakes the body.
  * Does not change the body's position or velocity; see body_tick().
  *
  * @param body the pointer to the body
@@ -207,4 +402,83 @@ bool body_is_removed(body_t *body);
  */
 void body_free(body_t *body);
 
+/**
+ * The current and previous positions, velocities, accumulated forces and
+ * impulses, inverse masses, collision filters, kinds and sleep state of a set
+ * of bodies, stored one row per body in parallel arrays, so that passes over
+ * all of them stream through memory.
+ * A body_t is a handle to its row, plus the data only its own accessors use.
+ * A scene keeps its bodies in one store; a body outside a scene has its own.
+ */
+typedef struct body_store body_store_t;
+
+/**
+ * Allocates memory for an empty body store.
+ * Asserts that the required memory is allocated.
+ *
+ * @param initial_capacity the number of bodies to allocate space for
+ * @return the new store
+ */
+body_store_t *body_store_init(size_t initial_capacity);
+
+/**
+ * Moves a body's row into a store.
+ * The body must not be in a store returned from body_store_init() yet.
+ *
+ * @param store a pointer to a store returned from body_store_init()
+ * @param body the body to move into the store
+ */
+void body_store_add(body_store_t *store, body_t *body);
+
+/**
+ * Ticks every body in a store, as body_tick() would, in one pass over the
+ * store's arrays, skipping the bodies that cannot move. Then puts the bodies
+ * that have been slow for long enough to sleep.
+ *
+ * @param store a pointer to a store returned from body_store_init()
+ * @param dt the number of seconds elapsed since the last tick
+ */
+void body_store_tick(body_store_t *store, double dt);
+
+/**
+ * Makes the dynamic bodies in a store fall asleep once they have been slower
+ * than a speed for a number of ticks in a row. Sleeping bodies are skipped by
+ * body_store_tick() until they wake. Bodies never fall asleep until this is
+ * called.
+ *
+ * @param store a pointer to a store returned from body_store_init()
+ * @param speed the speed a body must stay below
+ * @param ticks the number of ticks a body must stay below it for, or 0 to
+ *   stop bodies from falling asleep
+ */
+void body_store_set_sleeping(body_store_t *store, double speed, size_t ticks);
+
+/**
+ * Gets the bodies in a store that have been marked for removal with
+ * body_remove() since the store's removals were last cleared, in the order
+ * they were marked. Freeing them does not change the array.
+ *
+ * @param store a pointer to a store returned from body_store_init()
+ * @param size set to the number of bodies
+ * @return an array of the bodies, valid until the store's removals are
+ *   cleared or another body is marked
+ */
+body_t *const *body_store_get_removed(body_store_t *store, size_t *size);
+
+/**
+ * Forgets the bodies in a store that have been marked for removal, e.g.
+ * once they have been freed.
+ *
+ * @param store a pointer to a store returned from body_store_init()
+ */
+void body_store_clear_removed(body_store_t *store);
+
+/**
+ * Releases the memory allocated for a store.
+ * Asserts that every body in it has already been freed.
+ *
+ * @param store a pointer to a store returned from body_store_init()
+ */
+void body_store_free(body_store_t *store);
+
 #endif // #ifndef __BODY_H__
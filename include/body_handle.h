@@ -0,0 +1,77 @@
+#ifndef __BODY_HANDLE_H__
+#define __BODY_HANDLE_H__
+
+#include "body.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * A weak reference to a body: an index into the global body handle pool,
+ * plus the generation of the pool slot it was issued from.
+ * When a body is revoked its slot's generation changes, so every handle
+ * still held to it resolves to NULL instead of to a freed body. Holders can
+ * therefore keep handles to bodies that may be removed without being told
+ * about the removal.
+ */
+typedef struct {
+  uint32_t index;
+  uint32_t generation;
+} body_handle_t;
+
+/**
+ * A handle that never refers to a body.
+ */
+extern const body_handle_t BODY_HANDLE_NONE;
+
+/**
+ * Gets the handle to a body, issuing one if the body does not have one yet.
+ * A scene issues one to every body added to it (see scene_add_body()).
+ * The pool is created on first use.
+ * Asserts that the required memory is successfully allocated.
+ *
+ * @param body the body
+ * @return the body's handle
+ */
+body_handle_t body_handle_issue(body_t *body);
+
+/**
+ * Gets the body a handle refers to.
+ *
+ * @param handle a handle returned from body_handle_issue(), or
+ *   BODY_HANDLE_NONE
+ * @return the body, or NULL if the handle is BODY_HANDLE_NONE or its body has
+ *   been revoked
+ */
+body_t *body_handle_resolve(body_handle_t handle);
+
+/**
+ * Returns whether a handle is BODY_HANDLE_NONE.
+ *
+ * @param handle a handle
+ * @return whether the handle was never issued to a body
+ */
+bool body_handle_is_none(body_handle_t handle);
+
+/**
+ * Invalidates every handle to a body.
+ * Must be called before a body with a handle is freed, since a new body
+ * allocated at the same address could otherwise be given the old body's
+ * handle. A scene does this for the bodies it frees.
+ * Does nothing if the body has no handle.
+ *
+ * @param body the body to revoke
+ */
+void body_handle_revoke(body_t *body);
+
+/**
+ * Invalidates every handle, including those of bodies in scenes that have not
+ * been freed.
+ */
+void body_handle_clear(void);
+
+/**
+ * Frees the global body handle pool.
+ */
+void body_handle_destroy(void);
+
+#endif // #ifndef __BODY_HANDLE_H__
@@ -0,0 +1,84 @@
+#ifndef __BVH_H__
+#define __BVH_H__
+
+#include "body.h"
+#include "collision.h"
+#include "list.h"
+#include "vector.h"
+
+/**
+ * An immutable bounding volume hierarchy over a fixed set of bodies.
+ * Each leaf holds one body's axis-aligned bounding box, and each internal node
+ * bounds its two children.
+ * Intended for level geometry that rarely changes: the bounds and filters
+ * are captured when the hierarchy is built and never refreshed, so it must
+ * be rebuilt when its bodies move or are removed.
+ */
+typedef struct bvh bvh_t;
+
+/**
+ * Builds a hierarchy over the current bounding boxes and filters (see
+ * body_get_filter()) of some bodies.
+ * Does not take ownership of the list or the bodies.
+ * Asserts that the required memory is successfully allocated.
+ *
+ * @param bodies the bodies to build the hierarchy over; may be empty
+ * @return the new hierarchy
+ */
+bvh_t *bvh_init(list_t *bodies);
+
+/**
+ * Finds the bodies whose bounding boxes overlap a region.
+ * Subtrees containing no body that can collide with the query's filter are
+ * skipped without checking their bounds.
+ * Returns a newly allocated list, which must be list_free()d.
+ * The list does not own the bodies.
+ *
+ * @param bvh a pointer to a hierarchy returned from bvh_init()
+ * @param min the bottom left corner of the region
+ * @param max the top right corner of the region
+ * @param filter the layers the query belongs to and collides with
+ * @return a list of the overlapping bodies
+ */
+list_t *bvh_query(bvh_t *bvh, vector_t min, vector_t max,
+                  collision_filter_t filter);
+
+/**
+ * Finds the bodies whose bounding boxes contain a point.
+ * Returns a newly allocated list, which must be list_free()d.
+ * The list does not own the bodies.
+ *
+ * @param bvh a pointer to a hierarchy returned from bvh_init()
+ * @param point the point to test
+ * @param filter the layers the query belongs to and collides with
+ * @return a list of the bodies containing the point
+ */
+list_t *bvh_query_point(bvh_t *bvh, vector_t point, collision_filter_t filter);
+
+/**
+ * Finds the first bounding box hit by a ray, ignoring bodies that cannot
+ * collide with the ray's filter.
+ * The ray covers the points origin + t * direction for t in [0, max_time].
+ *
+ * @param bvh a pointer to a hierarchy returned from bvh_init()
+ * @param origin the start of the ray
+ * @param direction the direction of the ray; need not be a unit vector
+ * @param max_time the largest multiple of `direction` to travel
+ * @param filter the layers the ray belongs to and collides with
+ * @param time if a body is hit, set to the t at which the ray enters its
+ *   bounding box (0 if the origin is already inside)
+ * @return the body that is hit first, or NULL if none is hit
+ */
+body_t *bvh_raycast(bvh_t *bvh, vector_t origin, vector_t direction,
+                    double max_time, collision_filter_t filter,
+                    double *time);
+
+/**
+ * Releases memory allocated for a hierarchy.
+ * Does not free the bodies it was built over.
+ *
+ * @param bvh a pointer to a hierarchy returned from bvh_init()
+ */
+void bvh_free(bvh_t *bvh);
+
+#endif // #ifndef __BVH_H__
@@ -3,8 +3,10 @@
 
 #include "body.h"
 #include "list.h"
+#include "shape_view.h"
 #include "vector.h"
 #include <stdbool.h>
+#include <stdint.h>
 
 typedef enum {
   NO_COLLISION = 0,
@@ -29,13 +31,231 @@ typedef struct {
    * If the shapes are colliding, the axis they are colliding on.
    * This is a unit vector pointing from the first shape towards the second.
    * Normal impulses are applied along this axis.
-   * If collided is false, this value is undefined.
+   * If collided is false, this is either an axis the shapes are separated
+   * along, or VEC_ZERO if the test that was used does not produce one.
    */
   vector_t axis;
 } collision_info_t;
 
+/**
+ * The algorithms find_collision_using() can test a pair of shapes with.
+ */
+typedef enum {
+  /**
+   * The separating axis test, or a specialized test for the pair's kinds.
+   * Cheapest for boxes and shapes with few vertices.
+   */
+  NARROW_PHASE_SAT = 0,
+  /**
+   * GJK, followed by EPA for the axis if the shapes collide.
+   * Visits only a few vertices per support search, so it scales better than
+   * the separating axis test as the number of vertices grows.
+   */
+  NARROW_PHASE_GJK = 1
+} narrow_phase_t;
+
+/**
+ * A borrowed view of a convex shape, tagged with its kind.
+ * The vertices are not owned by the view and must outlive it.
+ */
+typedef struct {
+  /** Which collision test to use for this shape; see shape_view_t */
+  shape_kind_t kind;
+  /** The vertices of the shape, in counterclockwise order */
+  const vector_t *vertices;
+  /** The x-coordinates of the same vertices, for vectorized projections */
+  const double *x;
+  /** The y-coordinates of the same vertices, for vectorized projections */
+  const double *y;
+  /**
+   * The unit normals of the shape's edges, if they have already been
+   * computed, or NULL to compute them as they are needed
+   */
+  const vector_t *normals;
+  /** The number of vertices in the shape */
+  size_t size;
+  /** The bottom left corner of the shape's axis-aligned bounding box */
+  vector_t min;
+  /** The top right corner of the shape's axis-aligned bounding box */
+  vector_t max;
+} collision_shape_t;
+
+/**
+ * Computes the status of the collision between two convex polygons.
+ * The polygons are given as arrays of vertices in counterclockwise order.
+ * Reads the vertices in place and does not allocate any memory.
+ *
+ * @param shape1 the vertices of the first shape
+ * @param size1 the number of vertices in the first shape
+ * @param shape2 the vertices of the second shape
+ * @param size2 the number of vertices in the second shape
+ * @return whether the shapes are colliding, and if so, the collision axis.
+ * The axis should be a unit vector pointing from shape1 towards shape2.
+ */
+collision_info_t find_polygon_collision(const vector_t *shape1, size_t size1,
+                                        const vector_t *shape2, size_t size2);
+
+/**
+ * Computes the status of the collision between two classified shapes.
+ * Dispatches on the pair of shape kinds, falling back to the general
+ * polygon test when the pair has no specialized test.
+ *
+ * @param shape1 the first shape
+ * @param shape2 the second shape
+ * @return whether the shapes are colliding, and if so, the collision axis.
+ * The axis should be a unit vector pointing from shape1 towards shape2.
+ */
+collision_info_t find_shape_collision(const collision_shape_t *shape1,
+                                      const collision_shape_t *shape2);
+
+/**
+ * Computes the status of the collision between two classified shapes with
+ * GJK, and if they collide, finds the axis of least overlap with EPA.
+ * Ellipses are searched through their exact support points.
+ * Unlike find_shape_collision(), the axis is the true minimum translation
+ * direction, always oriented from shape1 towards shape2, so it may differ
+ * from the separating axis test's.
+ * Exactly touching shapes count as colliding, as in find_shape_collision().
+ * Does not allocate any memory.
+ *
+ * @param shape1 the first shape
+ * @param shape2 the second shape
+ * @param depth if not NULL and the shapes collide, set to how far they
+ *   overlap along the axis
+ * @return whether the shapes are colliding, and if so, the collision axis;
+ *   if not, an axis that separates them
+ */
+collision_info_t find_gjk_collision(const collision_shape_t *shape1,
+                                    const collision_shape_t *shape2,
+                                    double *depth);
+
+/**
+ * Computes the status of the collision between two classified shapes with
+ * the chosen algorithm.
+ *
+ * @param shape1 the first shape
+ * @param shape2 the second shape
+ * @param narrow_phase which algorithm to test the pair with
+ * @return whether the shapes are colliding, and if so, the collision axis.
+ * The axis should be a unit vector pointing from shape1 towards shape2.
+ */
+collision_info_t find_shape_collision_using(const collision_shape_t *shape1,
+                                            const collision_shape_t *shape2,
+                                            narrow_phase_t narrow_phase);
+
+/**
+ * One body found colliding by find_collisions().
+ */
+typedef struct {
+  /** The index of the body in the array of candidates */
+  size_t index;
+  /** The collision axis, as find_collision() would report it */
+  vector_t axis;
+} collision_hit_t;
+
+/**
+ * Which shape in a contact the reference edge belongs to.
+ */
+typedef enum {
+  /** Neither shape has edges, e.g. two ellipses */
+  NO_REFERENCE = 0,
+  REFERENCE_SHAPE1 = 1,
+  REFERENCE_SHAPE2 = 2
+} reference_shape_t;
+
+/**
+ * Represents how two colliding shapes touch.
+ * The reference edge is the face of one shape that the other shape, the
+ * incident shape, is pressed against.
+ */
+typedef struct {
+  /** Whether the two shapes are colliding */
+  bool collided;
+  /**
+   * If the shapes are colliding, the collision axis, as a unit vector
+   * pointing from the first shape towards the second.
+   * If not, as in collision_info_t.
+   */
+  vector_t axis;
+  /** How far the shapes overlap along the axis */
+  double depth;
+  /** The number of contact points, up to 2; 0 if not colliding */
+  size_t num_points;
+  /** Where the incident shape touches or crosses the reference edge */
+  vector_t points[2];
+  /** Which shape the reference edge belongs to */
+  reference_shape_t reference;
+  /** The reference edge's first vertex, in counterclockwise order */
+  vector_t reference_start;
+  /** The reference edge's second vertex, in counterclockwise order */
+  vector_t reference_end;
+  /** The reference edge's outward unit normal */
+  vector_t reference_normal;
+} contact_info_t;
+
+/**
+ * Computes how two classified shapes touch, in the same pass that decides
+ * whether they collide.
+ * The collision result matches find_shape_collision()'s, except that the axis
+ * is oriented from shape1 towards shape2.
+ * Ellipses have no edges, so an ellipse is only ever the incident shape.
+ *
+ * @param shape1 the first shape
+ * @param shape2 the second shape
+ * @return the contact between the shapes; only `collided` and `axis` are
+ *   meaningful if they are not colliding, and the reference edge is only
+ *   meaningful if `reference` is not NO_REFERENCE
+ */
+contact_info_t find_shape_contact(const collision_shape_t *shape1,
+                                  const collision_shape_t *shape2);
+
+/**
+ * Determines whether two bodies could ever collide, based on their filters.
+ * Each must belong to a layer in the other's mask.
+ * This is meant to be checked before any geometric test.
+ *
+ * @param filter1 the first body's filter
+ * @param filter2 the second body's filter
+ * @return whether the bodies' layers allow them to collide
+ */
+bool can_collide(collision_filter_t filter1, collision_filter_t filter2);
+
+/**
+ * Computes the axis-aligned bounding box of a body's current shape.
+ *
+ * @param body the body
+ * @param min set to the bottom left corner of the bounds
+ * @param max set to the top right corner of the bounds
+ */
+void find_bounding_box(body_t *body, vector_t *min, vector_t *max);
+
+/**
+ * Finds when a box moving in a straight line first touches a stationary box.
+ * This catches bodies that move further in one tick than an obstacle is
+ * thick, which discrete tests at the start and end of the tick would miss.
+ * Boxes that already overlap at the start are not reported, and neither are
+ * boxes that only slide along or graze each other's faces.
+ *
+ * @param min1 the bottom left corner of the moving box at the start
+ * @param max1 the top right corner of the moving box at the start
+ * @param displacement how far the moving box travels
+ * @param min2 the bottom left corner of the stationary box
+ * @param max2 the top right corner of the stationary box
+ * @param time if the boxes touch, set to the fraction of the displacement,
+ *   in [0, 1], at which they first do
+ * @param normal if the boxes touch, set to the stationary box's outward unit
+ *   normal on the face that is hit
+ * @return whether the moving box hits the stationary one during the move
+ */
+bool find_time_of_impact(vector_t min1, vector_t max1, vector_t displacement,
+                         vector_t min2, vector_t max2, double *time,
+                         vector_t *normal);
+
 /**
  * Computes the status of the collision between two bodies.
+ * The bodies' vertices are borrowed from the shape caches kept on the bodies
+ * (see shape_view_get()), so a body's shape is only copied again after it
+ * moves.
  *
  * @param body1 the first body
  * @param body2 the second body
@@ -44,4 +264,104 @@ typedef struct {
  */
 collision_info_t find_collision(body_t *body1, body_t *body2);
 
+/**
+ * Computes the status of the collision between two bodies, like
+ * find_collision(), with the chosen algorithm.
+ * Pairs of shapes with many vertices each, such as detailed hulls, are
+ * usually faster with NARROW_PHASE_GJK.
+ *
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param narrow_phase which algorithm to test the pair with
+ * @return whether the shapes are colliding, and if so, the collision axis.
+ * The axis should be a unit vector pointing from shape1 towards shape2.
+ */
+collision_info_t find_collision_using(body_t *body1, body_t *body2,
+                                      narrow_phase_t narrow_phase);
+
+/**
+ * Computes how two bodies touch, so that callers can resolve and classify
+ * a contact without fetching the bodies' shapes again.
+ *
+ * @param body1 the first body
+ * @param body2 the second body
+ * @return the contact between the bodies, as in find_shape_contact()
+ */
+contact_info_t find_contact(body_t *body1, body_t *body2);
+
+/**
+ * Remembers, for a bounded number of recently tested pairs of bodies, the
+ * result of their last test and each body's version at the time (see
+ * body_get_version()).
+ * A body's shape only changes along with its version, so a pair in which
+ * neither version has changed gets its old result back without its shapes
+ * being copied.
+ * Otherwise, if the pair was apart, the axis that separated them is tried
+ * first: bodies in a platformer rarely move far between frames, so one
+ * projection usually settles the test.
+ */
+typedef struct collision_cache collision_cache_t;
+
+/**
+ * Allocates memory for an empty collision cache.
+ * Asserts that the required memory is successfully allocated.
+ *
+ * @return the new cache
+ */
+collision_cache_t *collision_cache_init(void);
+
+/**
+ * Computes the status of the collision between two bodies, like
+ * find_collision(), reusing what the cache remembers about the pair.
+ * Whether the bodies collide always matches find_collision(). When they do
+ * not, the axis may be a separating axis remembered from an earlier call
+ * rather than the one find_collision() would pick.
+ *
+ * @param cache a pointer to a cache returned from collision_cache_init(),
+ *   or NULL to always run the full test
+ * @param body1 the first body
+ * @param body2 the second body
+ * @return whether the shapes are colliding, and if so, the collision axis.
+ * The axis should be a unit vector pointing from shape1 towards shape2.
+ */
+collision_info_t find_collision_cached(collision_cache_t *cache,
+                                       body_t *body1, body_t *body2);
+
+/**
+ * Tests one body against many, finding every candidate it collides with.
+ * The body's shape is fetched and classified once, and its projections onto
+ * its own edge normals are computed once and reused for every candidate.
+ * Each hit is the same as find_collision(body, candidate) would report.
+ *
+ * @param cache a pointer to a cache returned from collision_cache_init(),
+ *   used as in find_collision_cached(), or NULL
+ * @param body the body to test
+ * @param candidates the bodies to test it against
+ * @param count the number of candidates
+ * @param hits filled with one entry per colliding candidate, in candidate
+ *   order; must have room for `count` entries
+ * @return the number of hits
+ */
+size_t find_collisions(collision_cache_t *cache, body_t *body,
+                       body_t **candidates, size_t count,
+                       collision_hit_t *hits);
+
+/**
+ * Forgets every pair involving a body, e.g. before it is freed.
+ * A new body allocated at the same address is never given the old body's
+ * results, since its version differs, but until then the old pairs take up
+ * room in the cache.
+ *
+ * @param cache a pointer to a cache returned from collision_cache_init()
+ * @param body the body to forget
+ */
+void collision_cache_remove(collision_cache_t *cache, body_t *body);
+
+/**
+ * Releases memory allocated for a collision cache.
+ *
+ * @param cache a pointer to a cache returned from collision_cache_init()
+ */
+void collision_cache_free(collision_cache_t *cache);
+
 #endif // #ifndef __COLLISION_H__
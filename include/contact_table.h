@@ -0,0 +1,88 @@
+#ifndef __CONTACT_TABLE_H__
+#define __CONTACT_TABLE_H__
+
+#include "body.h"
+#include "body_handle.h"
+#include "vector.h"
+#include <stddef.h>
+
+/**
+ * Tracks which pairs of bodies are touching from one step to the next, so
+ * callers can react when a contact begins or ends instead of each keeping
+ * its own "were they colliding last time" state.
+ * Each step, the pairs found colliding are reported, and then the table is
+ * updated, producing one event per pair that was or is in contact.
+ * Pairs are keyed by the bodies' handles (see body_handle_issue()), so a
+ * removed body's contacts simply end.
+ */
+typedef struct contact_table contact_table_t;
+
+typedef enum {
+  /** The pair was reported this step but not the step before */
+  CONTACT_BEGIN,
+  /** The pair was reported both this step and the step before */
+  CONTACT_PERSIST,
+  /** The pair was reported the step before but not this step */
+  CONTACT_END,
+} contact_event_type_t;
+
+typedef struct {
+  contact_event_type_t type;
+  /** The bodies, in the order they were reported; for an ended contact
+   * either may have been revoked, in which case it resolves to NULL */
+  body_handle_t body1;
+  body_handle_t body2;
+  /** The collision axis last reported for the pair */
+  vector_t axis;
+} contact_event_t;
+
+/**
+ * Allocates memory for an empty contact table.
+ * Asserts that the required memory is successfully allocated.
+ *
+ * @return the new table
+ */
+contact_table_t *contact_table_init(void);
+
+/**
+ * Reports that two bodies are colliding in the current step.
+ * Reporting the same ordered pair again in a step only updates its axis, so
+ * several callers can report the same pair.
+ * Issues handles to the bodies if they do not have them yet.
+ *
+ * @param table a pointer to a table returned from contact_table_init()
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param axis the collision axis, pointing from body1 towards body2
+ * @return CONTACT_BEGIN if the pair was not in contact after the previous
+ *   step, so its contact begins in this one, or CONTACT_PERSIST if it was
+ */
+contact_event_type_t contact_table_report(contact_table_t *table,
+                                          body_t *body1, body_t *body2,
+                                          vector_t axis);
+
+/**
+ * Ends the current step: compares the pairs reported during it with the
+ * pairs in contact after the previous step, and starts a new step.
+ * A pair that was in contact but was not reported persists if its bodies
+ * are resting: one is asleep, and the other is asleep or static (see
+ * body_is_sleeping()), since resting bodies are not tested.
+ * Only pairs in contact are visited, however many were ever reported.
+ *
+ * @param table a pointer to a table returned from contact_table_init()
+ * @param events set to an array of this step's events, which stays valid
+ *   until the next update; pairs that began or persisted come first, in no
+ *   particular order, followed by pairs that ended
+ * @return the number of events
+ */
+size_t contact_table_update(contact_table_t *table,
+                            const contact_event_t **events);
+
+/**
+ * Releases memory allocated for a contact table.
+ *
+ * @param table a pointer to a table returned from contact_table_init()
+ */
+void contact_table_free(contact_table_t *table);
+
+#endif // #ifndef __CONTACT_TABLE_H__
@@ -65,7 +65,11 @@ void create_drag(scene_t *scene, double gamma, body_t *body);
  * This generalizes create_destructive_collision() from last week,
  * allowing different things to happen on a collision.
  * The handler is passed the bodies, the collision axis, and an auxiliary value.
- * It should only be called once while the bodies are still colliding.
+ * It is only called when the bodies' contact begins, not again while they
+ * are still colliding. The pair is reported to the scene's contacts (see
+ * scene_get_contacts()), so its contact also persists and ends there.
+ * Bodies whose filters keep them from colliding (see body_get_filter() and
+ * can_collide()) are not tested at all.
  *
  * @param scene the scene containing the bodies
  * @param body1 the first body
@@ -79,6 +83,83 @@ void create_collision(scene_t *scene, body_t *body1, body_t *body2,
                       collision_handler_t handler, void *aux,
                       double force_const, free_func_t freer);
 
+/**
+ * One body tested against a changing set of bodies by a single force creator.
+ */
+typedef struct collision_group collision_group_t;
+
+/**
+ * A function that finds the bodies that may collide with a body, such as a
+ * query of a spatial hash or a bounding volume hierarchy.
+ * @param aux the auxiliary value the query was set with
+ * @param body the body to search around
+ * @param filter the layers to search with
+ * @return a newly allocated list of the bodies whose bounding boxes overlap
+ *   the body's, each once, which the caller list_free()s
+ */
+typedef list_t *(*broadphase_query_t)(void *aux, body_t *body,
+                                      collision_filter_t filter);
+
+/**
+ * Adds a force creator to a scene that calls a collision handler each time a
+ * body starts colliding with any member of a group, as if create_collision()
+ * had been called for the body and each member.
+ * Members are added afterwards with collision_group_add().
+ * Each tick, members whose bounding boxes miss the body's are skipped, and
+ * the rest are tested together in one batch, instead of through one force
+ * creator and one full test per member. Finding those members checks every
+ * member's bounds, unless the group is given a broadphase query with
+ * collision_group_set_broadphase().
+ * Like any force creator, the group is not called while the body is asleep
+ * (see scene_set_sleeping()), so nothing is tested and its contacts are kept
+ * until it wakes.
+ * The handler is passed the body as body1 and the member as body2, and is
+ * only called when their contact begins. Like create_collision(), the group
+ * reports its pairs to the scene's contacts.
+ * The group belongs to the scene, and is freed along with its force creator
+ * when the body is removed or the scene is freed.
+ *
+ * @param scene the scene containing the bodies
+ * @param body the body to test against the group
+ * @param handler a function to call whenever the body collides with a member
+ * @param aux an auxiliary value to pass to the handler
+ * @param force_const a constant to pass to the handler
+ * @param freer a function to free the auxiliary value
+ * @return the group, which is initially empty
+ */
+collision_group_t *create_group_collision(scene_t *scene, body_t *body,
+                                          collision_handler_t handler,
+                                          void *aux, double force_const,
+                                          free_func_t freer);
+
+/**
+ * Makes a collision group find the members near its body with a broadphase
+ * query, so each tick costs time in the number of nearby bodies instead of
+ * the number of members. Bodies the query finds that are not members are
+ * ignored.
+ *
+ * @param group a group returned from create_group_collision()
+ * @param query the function to find the bodies near the group's body with
+ * @param query_aux an auxiliary value to pass to the query
+ * @param filter the layers to pass to the query, which should include every
+ *   member's layer
+ */
+void collision_group_set_broadphase(collision_group_t *group,
+                                    broadphase_query_t query, void *query_aux,
+                                    collision_filter_t filter);
+
+/**
+ * Adds a member to a collision group.
+ * The group holds a body handle to the member (see body_handle_issue()), and
+ * drops the member once the handle is revoked, so a member must be revoked
+ * with body_handle_revoke() when it is removed.
+ * Adding a member that is already in the group has no effect.
+ *
+ * @param group a group returned from create_group_collision()
+ * @param member the body to add
+ */
+void collision_group_add(collision_group_t *group, body_t *member);
+
 /**
  * Adds a force creator to a scene that destroys two bodies when they collide.
  * The bodies are destroyed by calling body_remove().
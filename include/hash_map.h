@@ -0,0 +1,82 @@
+#ifndef __HASH_MAP_H__
+#define __HASH_MAP_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * An open-addressed map from 64-bit keys, usually pointers cast to
+ * uintptr_t, to indices or other size_t values.
+ * Modules that look bodies up by address keep their records in their own
+ * arrays and use a hash map to find a record's index.
+ * The map is kept at most half full, so lookups probe only a few slots.
+ */
+typedef struct hash_map hash_map_t;
+
+/**
+ * The value hash_map_get() returns for a key that is not in the map.
+ * It cannot be stored as a value.
+ */
+extern const size_t HASH_MAP_NONE;
+
+/**
+ * Allocates memory for an empty hash map.
+ * Asserts that the required memory is successfully allocated.
+ *
+ * @param initial_size the number of keys to make room for
+ * @return the new map
+ */
+hash_map_t *hash_map_init(size_t initial_size);
+
+/**
+ * Gets the value stored for a key.
+ *
+ * @param map a pointer to a map returned from hash_map_init()
+ * @param key the key
+ * @return the key's value, or HASH_MAP_NONE if the key is not in the map
+ */
+size_t hash_map_get(hash_map_t *map, uint64_t key);
+
+/**
+ * Stores a value for a key, replacing any value it already had.
+ * Grows the map if it would be more than half full.
+ * Asserts that the required memory is successfully allocated.
+ *
+ * @param map a pointer to a map returned from hash_map_init()
+ * @param key the key
+ * @param value the value, which must not be HASH_MAP_NONE
+ */
+void hash_map_put(hash_map_t *map, uint64_t key, size_t value);
+
+/**
+ * Removes a key from a map, if it is there.
+ *
+ * @param map a pointer to a map returned from hash_map_init()
+ * @param key the key
+ * @return the value the key had, or HASH_MAP_NONE if it was not in the map
+ */
+size_t hash_map_remove(hash_map_t *map, uint64_t key);
+
+/**
+ * Gets the number of keys in a map.
+ *
+ * @param map a pointer to a map returned from hash_map_init()
+ * @return the number of keys
+ */
+size_t hash_map_size(hash_map_t *map);
+
+/**
+ * Removes every key from a map, keeping its memory for reuse.
+ *
+ * @param map a pointer to a map returned from hash_map_init()
+ */
+void hash_map_clear(hash_map_t *map);
+
+/**
+ * Releases memory allocated for a hash map.
+ *
+ * @param map a pointer to a map returned from hash_map_init()
+ */
+void hash_map_free(hash_map_t *map);
+
+#endif // #ifndef __HASH_MAP_H__
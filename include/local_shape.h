@@ -0,0 +1,99 @@
+#ifndef __LOCAL_SHAPE_H__
+#define __LOCAL_SHAPE_H__
+
+#include "list.h"
+#include "vector.h"
+#include <stddef.h>
+
+/**
+ * An immutable convex polygon in local space, i.e. relative to the centroid
+ * of the bodies that have it and before they are rotated, along with the unit
+ * normals of its edges.
+ * Identical shapes are shared: every request for the same vertices gets the
+ * same object, which is reference counted and freed when its last reference
+ * is released.
+ */
+typedef struct local_shape local_shape_t;
+
+/**
+ * Gets the shared shape with the given vertices, creating it if no shape
+ * with exactly those vertices exists yet.
+ * The caller owns one reference to the returned shape, and must release it
+ * with local_shape_release().
+ * Asserts that the required memory is successfully allocated.
+ *
+ * @param vertices the vertices of the shape relative to its centroid, in
+ *   counterclockwise order; copied into the shape
+ * @param size the number of vertices, at least 3
+ * @return the shape
+ */
+local_shape_t *local_shape_get(const vector_t *vertices, size_t size);
+
+/**
+ * Takes another reference to a shape.
+ *
+ * @param shape a shape returned from local_shape_get()
+ * @return the same shape
+ */
+local_shape_t *local_shape_retain(local_shape_t *shape);
+
+/**
+ * Releases a reference to a shape, freeing it if it was the last one.
+ *
+ * @param shape a shape returned from local_shape_get()
+ */
+void local_shape_release(local_shape_t *shape);
+
+/**
+ * Gets the number of vertices in a shape.
+ *
+ * @param shape a shape returned from local_shape_get()
+ * @return the number of vertices
+ */
+size_t local_shape_size(const local_shape_t *shape);
+
+/**
+ * Gets the vertices of a shape, relative to its centroid.
+ *
+ * @param shape a shape returned from local_shape_get()
+ * @return an array of local_shape_size(shape) vertices
+ */
+const vector_t *local_shape_vertices(const local_shape_t *shape);
+
+/**
+ * Gets the x-coordinates of a shape's vertices, relative to its centroid.
+ *
+ * @param shape a shape returned from local_shape_get()
+ * @return an array of local_shape_size(shape) coordinates
+ */
+const double *local_shape_x(const local_shape_t *shape);
+
+/**
+ * Gets the y-coordinates of a shape's vertices, relative to its centroid.
+ *
+ * @param shape a shape returned from local_shape_get()
+ * @return an array of local_shape_size(shape) coordinates
+ */
+const double *local_shape_y(const local_shape_t *shape);
+
+/**
+ * Gets the unit normals of a shape's edges, computed when the shape was
+ * created. Edge i runs from vertex i to vertex i + 1 (wrapping around).
+ *
+ * @param shape a shape returned from local_shape_get()
+ * @return an array of local_shape_size(shape) normals
+ */
+const vector_t *local_shape_normals(const local_shape_t *shape);
+
+/**
+ * Places a shape's vertices around a centroid, for building a body from it.
+ * Returns a newly allocated list, which the caller owns, e.g. by passing it
+ * to body_init().
+ *
+ * @param shape a shape returned from local_shape_get()
+ * @param centroid where to place the shape's centroid
+ * @return a list of vectors
+ */
+list_t *local_shape_place(const local_shape_t *shape, vector_t centroid);
+
+#endif // #ifndef __LOCAL_SHAPE_H__
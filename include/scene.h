@@ -2,6 +2,7 @@
 #define __SCENE_H__
 
 #include "body.h"
+#include "contact_table.h"
 #include "list.h"
 
 /**
@@ -47,7 +48,10 @@ size_t scene_bodies(scene_t *scene);
 body_t *scene_get_body(scene_t *scene, size_t index);
 
 /**
- * Adds a body to a scene, taking ownership of the body.
+ * Adds a body to a scene, taking ownership of the body, and issues the body
+ * a handle (see body_handle_issue()).
+ * The scene revokes the handle when it frees the body, so handles to a
+ * removed body resolve to NULL from the end of the next scene_tick().
  *
  * @param scene a pointer to a scene returned from scene_init()
  * @param body a pointer to the body to add to the scene
@@ -57,7 +61,10 @@ void scene_add_body(scene_t *scene, body_t *body);
 /**
  * @deprecated Use body_remove() instead
  *
- * Removes and frees the body at a given index from a scene.
+ * Marks the body at a given index in a scene for removal, as body_remove()
+ * does. The body is not removed and freed until the end of the next
+ * scene_tick(), so it stays at the same index, and the pointer to it stays
+ * valid, until then.
  * Asserts that the index is valid.
  *
  * @param scene a pointer to a scene returned from scene_init()
@@ -84,12 +91,104 @@ void scene_remove_body(scene_t *scene, size_t index);
 void scene_add_force_creator(scene_t *scene, force_creator_t force_creator,
                              void *aux, list_t *bodies, free_func_t freer);
 
+/**
+ * Makes the dynamic bodies in a scene fall asleep once they have been slower
+ * than a speed for a number of ticks in a row, so scene_tick() stops moving
+ * them until they wake (see body_is_sleeping()).
+ * A force creator whose bodies are all asleep, apart from static ones, is not
+ * called until one of them wakes.
+ * Bodies never fall asleep until this is called.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param speed the speed a body must stay below
+ * @param ticks the number of ticks a body must stay below it for, or 0 to
+ *   stop bodies from falling asleep
+ */
+void scene_set_sleeping(scene_t *scene, double speed, size_t ticks);
+
+/**
+ * Gets the contact table that a scene's collision creators report the pairs
+ * they find colliding to (see forces.h), so every pair's contact begins,
+ * persists and ends the same way, whichever creators test it.
+ * scene_tick() updates the table once all the force creators have run.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the scene's table, which the scene owns
+ */
+contact_table_t *scene_get_contacts(scene_t *scene);
+
+/**
+ * Gets the events of the pairs in contact during the last scene_tick(), or
+ * that stopped being in contact then (see contact_table_update()).
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param events set to an array of the events, valid until the next tick
+ * @return the number of events
+ */
+size_t scene_get_contact_events(scene_t *scene,
+                                const contact_event_t **events);
+
+/**
+ * Gives a scene a broadphase, which files each body under its filter (see
+ * body_set_filter()), so scene_query() can find the bodies near a region
+ * without testing every body.
+ * Static bodies, such as level geometry, are filed in a bounding volume
+ * hierarchy (see bvh.h), which is rebuilt by the first query after one is
+ * added, moved or removed. Every other body is filed in a spatial hash with
+ * square cells of a given size (see spatial_hash.h).
+ * Bodies that move, turn, change shape or change kind are refiled at the end
+ * of each scene_tick(), and removed bodies are unfiled before they are freed.
+ * Asserts that the scene does not have a broadphase yet.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param cell_size the width and height of each cell, e.g. about the size of
+ *   the bodies that move
+ */
+void scene_set_broadphase(scene_t *scene, double cell_size);
+
+/**
+ * Finds the bodies in a scene whose bounding boxes overlap a region, and
+ * whose filters allow them to collide with the query's filter.
+ * Each body is found where it was when it was added or at the end of the
+ * last scene_tick(), whichever was later. Bodies marked for removal are left
+ * out.
+ * Asserts that the scene has a broadphase (see scene_set_broadphase()).
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param min the bottom left corner of the region
+ * @param max the top right corner of the region
+ * @param filter the layers the query belongs to and collides with
+ * @return a new list of each overlapping body, once, which does not own them
+ *   and must be list_free()d
+ */
+list_t *scene_query(scene_t *scene, vector_t min, vector_t max,
+                    collision_filter_t filter);
+
+/**
+ * Finds the bodies in a scene near a body, as scene_query() does for the
+ * body's current bounding box, leaving out the body itself.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param body the body to search around
+ * @param filter the layers to search with
+ * @return a new list of each overlapping body, which does not own them and
+ *   must be list_free()d
+ */
+list_t *scene_query_body(scene_t *scene, body_t *body,
+                         collision_filter_t filter);
+
 /**
  * Executes a tick of a given scene over a small time interval.
- * This requires executing all the force creators
+ * This requires executing all the force creators, except those whose bodies
+ * are all asleep (see scene_set_sleeping()), updating the contacts they
+ * reported (see scene_get_contacts()),
  * and then ticking each body (see body_tick()).
- * If any bodies are marked for removal, they are removed from the scene
- * and freed, along with any force creators acting on them.
+ * In a scene with a broadphase, continuous bodies that passed all the way
+ * through something during the tick are then moved back to where they first
+ * touched it (see body_set_continuous()).
+ * If any bodies are marked for removal, they are removed from the scene,
+ * along with any force creators acting on them, and their handles are
+ * revoked before they are freed.
  *
  * @param scene a pointer to a scene returned from scene_init()
  * @param dt the time elapsed since the last tick, in seconds
@@ -98,7 +197,8 @@ void scene_tick(scene_t *scene, double dt);
 
 /**
  * Releases memory allocated for a given scene
- * and all the bodies and force creators it contains.
+ * and all the bodies and force creators it contains,
+ * revoking the bodies' handles.
  *
  * @param scene a pointer to a scene returned from scene_init()
  */
@@ -72,6 +72,18 @@ bool sdl_is_done(state_t *state);
  */
 void sdl_clear(void);
 
+/**
+ * Draws each body part of the way from where it was before the last tick
+ * that moved it to where it is now (see body_get_previous_centroid()),
+ * without moving it, until this is next called.
+ * Applies to sdl_draw_body() and sdl_get_body_bounding_box().
+ * Bodies are drawn where they are until this is first called.
+ *
+ * @param alpha how far to draw each body along the way, from 0 for where it
+ *   was to 1 for where it is
+ */
+void sdl_set_interpolation(double alpha);
+
 /**
  * Returns the SDL_Rect bounding box when given a body.
  *
@@ -0,0 +1,105 @@
+#ifndef __SHAPE_VIEW_H__
+#define __SHAPE_VIEW_H__
+
+#include "body.h"
+#include "vector.h"
+#include <stddef.h>
+
+/**
+ * The kinds of shapes that find_collision() has specialized tests for.
+ * Shapes that do not match a more specific kind are treated as general
+ * convex polygons.
+ */
+typedef enum {
+  SHAPE_POLYGON = 0,
+  /** A box whose four edges are all axis-aligned */
+  SHAPE_AABB = 1,
+  /**
+   * The axis-aligned ellipse inscribed in the shape's bounding box; the
+   * vertices are only a tessellation of it for drawing.
+   * Only bodies declared with shape_view_set_ellipse() have this kind.
+   */
+  SHAPE_ELLIPSE = 2,
+  SHAPE_KIND_COUNT
+} shape_kind_t;
+
+/**
+ * A read-only view of a body's current world-space vertices, borrowed from
+ * the shape cache kept on the body (see body_get_shape_cache()) instead of
+ * copied out of the body.
+ * The cache copies a body's shape once, and again only after the body's
+ * version changes (see body_get_version()), so bodies that stay put are never
+ * copied twice. The shape's kind and bounding box are found along with each
+ * copy, and its edge normals are cached the same way when first asked for.
+ * The vertices are also kept as separate x and y coordinate arrays, in the
+ * form the collision tests project them in.
+ */
+typedef struct {
+  /** The vertices of the shape, in counterclockwise order */
+  const vector_t *vertices;
+  /** The x-coordinates of the same vertices */
+  const double *x;
+  /** The y-coordinates of the same vertices */
+  const double *y;
+  /** The number of vertices in the shape */
+  size_t size;
+  /** Which specialized collision test the shape can use */
+  shape_kind_t kind;
+  /** The bottom left corner of the shape's axis-aligned bounding box */
+  vector_t min;
+  /** The top right corner of the shape's axis-aligned bounding box */
+  vector_t max;
+} shape_view_t;
+
+/**
+ * Gets a view of a body's current shape.
+ * The view stays valid until the body next moves or turns, or until it is
+ * freed. Views of other bodies can be fetched in the meantime without
+ * invalidating it.
+ * The body's cache is created on first use, and freed along with the body.
+ *
+ * @param body the body whose shape to view
+ * @return a view of the body's world-space vertices
+ */
+shape_view_t shape_view_get(body_t *body);
+
+/**
+ * Gets the unit normals of a body's current edges.
+ * Edge i runs from vertex i to vertex i + 1 (wrapping around), and its normal
+ * is the edge rotated by 90 degrees counterclockwise, so it points outward.
+ * Computed at most once per position of the body.
+ * Stays valid for as long as the body's shape view does.
+ *
+ * @param body the body
+ * @return an array of shape_view_get(body).size normals
+ */
+const vector_t *shape_view_get_normals(body_t *body);
+
+/**
+ * Gets the axis-aligned bounding box of a body's current shape, as
+ * shape_view_get() would report it.
+ *
+ * @param body the body
+ * @param min set to the bottom left corner of the bounds
+ * @param max set to the top right corner of the bounds
+ */
+void shape_view_get_bounds(body_t *body, vector_t *min, vector_t *max);
+
+/**
+ * Declares that a body is the axis-aligned ellipse inscribed in its bounding
+ * box, so that while it is unrotated it collides as that exact ellipse
+ * (SHAPE_ELLIPSE) and its vertices are only a tessellation for drawing.
+ * A rotated body collides as the polygon its vertices form.
+ *
+ * @param body the body, whose vertices should lie on the ellipse
+ */
+void shape_view_set_ellipse(body_t *body);
+
+/**
+ * Frees a body's shape cache. Called by body_free().
+ *
+ * @param cache a cache returned from body_get_shape_cache()
+ */
+void shape_cache_free(shape_cache_t *cache);
+
+#endif // #ifndef __SHAPE_VIEW_H__
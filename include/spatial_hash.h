@@ -0,0 +1,100 @@
+#ifndef __SPATIAL_HASH_H__
+#define __SPATIAL_HASH_H__
+
+#include "body.h"
+#include "collision.h"
+#include "list.h"
+#include "vector.h"
+
+/**
+ * A uniform grid of square cells, hashed into a fixed number of buckets,
+ * that tracks which cells each body's bounding box covers.
+ * Used as a broadphase: it answers which bodies might overlap a region
+ * without testing every body in the scene.
+ */
+typedef struct spatial_hash spatial_hash_t;
+
+/**
+ * Allocates memory for an empty spatial hash.
+ * Asserts that the required memory is successfully allocated.
+ *
+ * @param cell_size the width and height of each grid cell
+ * @return the new spatial hash
+ */
+spatial_hash_t *spatial_hash_init(double cell_size);
+
+/**
+ * Starts tracking a body, inserting it into every cell its bounding box
+ * currently covers.
+ * Does not take ownership of the body.
+ * Asserts that the body is not already tracked.
+ *
+ * @param hash a pointer to a spatial hash returned from spatial_hash_init()
+ * @param body the body to track
+ * @param filter the collision layers the body belongs to and collides with
+ */
+void spatial_hash_add(spatial_hash_t *hash, body_t *body,
+                      collision_filter_t filter);
+
+/**
+ * Refreshes a tracked body's bounding box after it has moved.
+ * The body is only moved between buckets if the range of cells it covers
+ * has changed.
+ * Asserts that the body is tracked.
+ *
+ * @param hash a pointer to a spatial hash returned from spatial_hash_init()
+ * @param body the body that may have moved
+ */
+void spatial_hash_update(spatial_hash_t *hash, body_t *body);
+
+/**
+ * Stops tracking a body.
+ * Must be called before a tracked body is freed.
+ * Does nothing if the body is not tracked.
+ *
+ * @param hash a pointer to a spatial hash returned from spatial_hash_init()
+ * @param body the body to stop tracking
+ */
+void spatial_hash_remove(spatial_hash_t *hash, body_t *body);
+
+/**
+ * Finds the tracked bodies whose bounding boxes overlap a region.
+ * Bodies whose filters do not allow them to collide with the query's filter
+ * are skipped without checking their bounds.
+ * Returns a newly allocated list, which must be list_free()d.
+ * The list does not own the bodies.
+ *
+ * @param hash a pointer to a spatial hash returned from spatial_hash_init()
+ * @param min the bottom left corner of the region
+ * @param max the top right corner of the region
+ * @param filter the layers the query belongs to and collides with
+ * @return a list of each overlapping body, once
+ */
+list_t *spatial_hash_query(spatial_hash_t *hash, vector_t min, vector_t max,
+                           collision_filter_t filter);
+
+/**
+ * Finds the tracked bodies whose bounding boxes overlap a tracked body's
+ * bounding box, as of the last spatial_hash_add() or spatial_hash_update().
+ * The body itself is not included.
+ * Returns a newly allocated list, which must be list_free()d.
+ * Asserts that the body is tracked.
+ *
+ * @param hash a pointer to a spatial hash returned from spatial_hash_init()
+ * @param body the tracked body to search around
+ * @param filter the layers to search with, which may be narrower than the
+ *   filter the body was added with
+ * @return a list of each overlapping body, once
+ */
+list_t *spatial_hash_query_body(spatial_hash_t *hash, body_t *body,
+                                collision_filter_t filter);
+
+/**
+ * Releases memory allocated for a spatial hash.
+ * Does not free the bodies it tracks.
+ *
+ * @param hash a pointer to a spatial hash returned from spatial_hash_init()
+ */
+void spatial_hash_free(spatial_hash_t *hash);
+
+#endif // #ifndef __SPATIAL_HASH_H__
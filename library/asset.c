@@ -51,7 +51,7 @@ void asset_make_image_with_body(const char *filepath, body_t *body) {
   asset_t *asset = asset_init(ASSET_IMAGE, bounding_box);
   image_asset_t *image_asset = (image_asset_t *)asset;
   image_asset->texture = asset_cache_obj_get_or_create(ASSET_IMAGE, filepath);
-  image_asset->body = body;
+  image_asset->body = body_handle_issue(body);
   list_add(ASSET_LIST, (asset_t *)image_asset);
 }
 
@@ -59,7 +59,7 @@ void asset_make_image(const char *filepath, SDL_Rect bounding_box) {
   asset_t *asset = asset_init(ASSET_IMAGE, bounding_box);
   image_asset_t *image_asset = (image_asset_t *)asset;
   image_asset->texture = asset_cache_obj_get_or_create(ASSET_IMAGE, filepath);
-  image_asset->body = NULL;
+  image_asset->body = BODY_HANDLE_NONE;
   list_add(ASSET_LIST, (asset_t *)image_asset);
 }
 
@@ -85,7 +85,7 @@ void asset_make_spirit(const char *front_filepath, const char *left_filepath,
   spirit_asset->left_texture =
       asset_cache_obj_get_or_create(ASSET_IMAGE, left_filepath);
   spirit_asset->curr_texture = spirit_asset->front_texture;
-  spirit_asset->body = body;
+  spirit_asset->body = body_handle_issue(body);
   list_add(ASSET_LIST, (asset_t *)spirit_asset);
 }
 
@@ -101,7 +101,7 @@ void asset_make_anim(const char *frame1_filepath, const char *frame2_filepath,
   anim_asset->frame3_texture =
       asset_cache_obj_get_or_create(ASSET_IMAGE, frame3_filepath);
   anim_asset->curr_texture = anim_asset->frame1_texture;
-  anim_asset->body = body;
+  anim_asset->body = body_handle_issue(body);
   list_add(ASSET_LIST, (asset_t *)anim_asset);
 }
 
@@ -145,7 +145,7 @@ void asset_make_button(const char *unpressed_filepath,
   button_asset->pressed_texture =
       asset_cache_obj_get_or_create(ASSET_IMAGE, pressed_filepath);
   button_asset->curr_texture = button_asset->unpressed_texture;
-  button_asset->body = body;
+  button_asset->body = body_handle_issue(body);
   list_add(ASSET_LIST, (asset_t *)button_asset);
 }
 
@@ -164,19 +164,62 @@ void asset_reset_asset_list() {
 
 list_t *asset_get_asset_list() { return ASSET_LIST; }
 
-void asset_remove_body(body_t *body) {
-  size_t len = list_size(ASSET_LIST);
-  for (size_t i = 0; i < len; i++) {
+/**
+ * Finds where to render an asset that may be attached to a body.
+ *
+ * @param handle the handle to the asset's body, or BODY_HANDLE_NONE
+ * @param box set to the body's bounding box, if the asset has a body;
+ *   otherwise left unchanged
+ * @return false if the asset's body has been removed, so it is not rendered
+ */
+static bool get_render_box(body_handle_t handle, SDL_Rect *box) {
+  if (body_handle_is_none(handle)) {
+    return true;
+  }
+  body_t *body = body_handle_resolve(handle);
+  if (body == NULL) {
+    return false;
+  }
+  *box = sdl_get_body_bounding_box(body);
+  return true;
+}
+
+/**
+ * Gets the handle to the body an asset is attached to.
+ *
+ * @return the handle, or BODY_HANDLE_NONE if the asset has no body
+ */
+static body_handle_t get_body_handle(asset_t *asset) {
+  switch (asset->type) {
+  case ASSET_IMAGE:
+    return ((image_asset_t *)asset)->body;
+  case ASSET_SPIRIT:
+    return ((spirit_asset_t *)asset)->body;
+  case ASSET_BUTTON:
+    return ((button_asset_t *)asset)->body;
+  case ASSET_ANIM:
+    return ((anim_asset_t *)asset)->body;
+  case ASSET_TEXT:
+    break;
+  }
+  return BODY_HANDLE_NONE;
+}
+
+void asset_render_all(double time) {
+  if (ASSET_LIST == NULL) {
+    return;
+  }
+  for (size_t i = 0; i < list_size(ASSET_LIST); i++) {
     asset_t *asset = list_get(ASSET_LIST, i);
-    if (asset->type == ASSET_IMAGE) {
-      image_asset_t *image_asset = (image_asset_t *)asset;
-      if (image_asset->body == body) {
-        list_remove(ASSET_LIST, i);
-        asset_destroy(asset);
-        i--;
-        len--;
-      }
+    body_handle_t handle = get_body_handle(asset);
+    // an asset whose body was revoked is never rendered again; removing it
+    // shifts the later assets down, once per removed body
+    if (!body_handle_is_none(handle) && body_handle_resolve(handle) == NULL) {
+      asset_destroy(list_remove(ASSET_LIST, i--));
+      continue;
     }
+    asset_animate(asset, time);
+    asset_render(asset);
   }
 }
 
@@ -185,10 +228,9 @@ void asset_render(asset_t *asset) {
   switch (asset->type) {
   case ASSET_IMAGE: {
     image_asset_t *image = (image_asset_t *)asset;
-    if (image->body != NULL) {
-      box = sdl_get_body_bounding_box(image->body);
+    if (get_render_box(image->body, &box)) {
+      sdl_render_image(image->texture, &box);
     }
-    sdl_render_image(image->texture, &box);
     break;
   }
   case ASSET_TEXT: {
@@ -199,26 +241,23 @@ void asset_render(asset_t *asset) {
   }
   case ASSET_SPIRIT: {
     spirit_asset_t *spirit_asset = (spirit_asset_t *)asset;
-    if (spirit_asset->body != NULL) {
-      box = sdl_get_body_bounding_box(spirit_asset->body);
+    if (get_render_box(spirit_asset->body, &box)) {
+      sdl_render_image(spirit_asset->curr_texture, &box);
     }
-    sdl_render_image(spirit_asset->curr_texture, &box);
     break;
   }
   case ASSET_BUTTON: {
     button_asset_t *button_asset = (button_asset_t *)asset;
-    if (button_asset->body != NULL) {
-      box = sdl_get_body_bounding_box(button_asset->body);
+    if (get_render_box(button_asset->body, &box)) {
+      sdl_render_image(button_asset->curr_texture, &box);
     }
-    sdl_render_image(button_asset->curr_texture, &box);
     break;
   }
   case ASSET_ANIM: {
     anim_asset_t *anim_asset = (anim_asset_t *)asset;
-    if (anim_asset->body != NULL) {
-      box = sdl_get_body_bounding_box(anim_asset->body);
+    if (get_render_box(anim_asset->body, &box)) {
+      sdl_render_image(anim_asset->curr_texture, &box);
     }
-    sdl_render_image(anim_asset->curr_texture, &box);
     break;
   }
   }
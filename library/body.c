@@ -0,0 +1,811 @@
+#include "body.h"
+#include "shape_view.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
+
+/** Set in a row's flags once its body is marked for removal */
+static const uint8_t BODY_REMOVED = 1;
+/** Set in a row's flags when its body is static or kinematic */
+static const uint8_t BODY_IS_STATIC = 2;
+static const uint8_t BODY_IS_KINEMATIC = 4;
+/** Set in a row's flags while its body is asleep */
+static const uint8_t BODY_SLEEPING = 8;
+/** Set in a row's flags when a scene should stop its body from tunneling */
+static const uint8_t BODY_CONTINUOUS = 16;
+
+/**
+ * The version the next change to any body's centroid or rotation is given.
+ * Versions are shared by every store, so no two states of any bodies, even
+ * of a body freed and one allocated at its address, ever have the same one.
+ */
+static uint64_t NEXT_VERSION = 1;
+
+const collision_filter_t COLLISION_FILTER_ALL = {UINT32_MAX, UINT32_MAX};
+
+/**
+ * Parallel arrays with one row per body. Rows are kept dense: removing one
+ * moves the last into its place.
+ * The rows of bodies that can move come first. The rest are static, asleep,
+ * or have infinite mass and no velocity, so ticking them would change
+ * nothing, and body_store_tick() stops before them.
+ * Static and kinematic rows have an inverse mass of 0, so forces and
+ * impulses never change their velocities.
+ * A moving row's previous centroid is saved at the start of each tick; a
+ * still row's is kept equal to its centroid, since no tick will save it.
+ */
+struct body_store {
+  double *x;
+  double *y;
+  double *previous_x;
+  double *previous_y;
+  double *vx;
+  double *vy;
+  double *fx;
+  double *fy;
+  double *jx;
+  double *jy;
+  double *inv_mass;
+  /** Changes whenever the body's centroid or rotation does */
+  uint64_t *versions;
+  collision_filter_t *filters;
+  uint8_t *flags;
+  /** How many ticks in a row each dynamic row has been slower than
+   * sleep_speed */
+  uint32_t *still_ticks;
+  /** The body each row belongs to, so a moved row can update its body */
+  body_t **bodies;
+  size_t size;
+  size_t capacity;
+  /** The number of rows at the front whose bodies can move */
+  size_t num_moving;
+  /** Dynamic bodies fall asleep after sleep_ticks slow ticks; 0 if never */
+  double sleep_speed;
+  size_t sleep_ticks;
+
+  /** The bodies marked for removal, so the scene need not look for them */
+  body_t **removed;
+  size_t num_removed;
+  size_t removed_capacity;
+};
+
+struct body {
+  /** The vertices relative to the centroid, before rotation */
+  vector_t *local;
+  size_t size;
+  /** The shared shape the body was built from, if any */
+  local_shape_t *local_shape;
+  double rotation;
+  double mass;
+  color_t color;
+  void *info;
+  free_func_t info_freer;
+  /** The body's world-space shape, once it has been viewed */
+  shape_cache_t *shape_cache;
+
+  body_store_t *store;
+  size_t row;
+  /** Whether the store is this body's own, rather than a scene's */
+  bool owns_store;
+};
+
+/**
+ * Resizes every array of a store to the given capacity.
+ */
+static void resize_store(body_store_t *store, size_t capacity) {
+  store->x = realloc(store->x, capacity * sizeof(double));
+  store->y = realloc(store->y, capacity * sizeof(double));
+  store->previous_x = realloc(store->previous_x, capacity * sizeof(double));
+  store->previous_y = realloc(store->previous_y, capacity * sizeof(double));
+  store->vx = realloc(store->vx, capacity * sizeof(double));
+  store->vy = realloc(store->vy, capacity * sizeof(double));
+  store->fx = realloc(store->fx, capacity * sizeof(double));
+  store->fy = realloc(store->fy, capacity * sizeof(double));
+  store->jx = realloc(store->jx, capacity * sizeof(double));
+  store->jy = realloc(store->jy, capacity * sizeof(double));
+  store->inv_mass = realloc(store->inv_mass, capacity * sizeof(double));
+  store->versions = realloc(store->versions, capacity * sizeof(uint64_t));
+  store->filters =
+      realloc(store->filters, capacity * sizeof(collision_filter_t));
+  store->flags = realloc(store->flags, capacity * sizeof(uint8_t));
+  store->still_ticks =
+      realloc(store->still_ticks, capacity * sizeof(uint32_t));
+  store->bodies = realloc(store->bodies, capacity * sizeof(body_t *));
+  assert(store->x && store->y && store->previous_x && store->previous_y &&
+         store->vx && store->vy && store->fx && store->fy && store->jx &&
+         store->jy && store->inv_mass && store->versions && store->filters &&
+         store->flags && store->still_ticks && store->bodies);
+  store->capacity = capacity;
+}
+
+body_store_t *body_store_init(size_t initial_capacity) {
+  assert(initial_capacity > 0);
+  body_store_t *store = calloc(1, sizeof(body_store_t));
+  assert(store);
+  resize_store(store, initial_capacity);
+  return store;
+}
+
+/**
+ * Adds a body to its store's list of bodies marked for removal.
+ */
+static void add_removed(body_store_t *store, body_t *body) {
+  if (store->num_removed == store->removed_capacity) {
+    store->removed_capacity =
+        store->removed_capacity == 0 ? 1 : 2 * store->removed_capacity;
+    store->removed =
+        realloc(store->removed, store->removed_capacity * sizeof(body_t *));
+    assert(store->removed);
+  }
+  store->removed[store->num_removed++] = body;
+}
+
+/**
+ * Copies a row of one store over a row of another, and points the row's body
+ * at its new place.
+ */
+static void copy_row(body_store_t *to, size_t to_row, body_store_t *from,
+                     size_t from_row) {
+  to->x[to_row] = from->x[from_row];
+  to->y[to_row] = from->y[from_row];
+  to->previous_x[to_row] = from->previous_x[from_row];
+  to->previous_y[to_row] = from->previous_y[from_row];
+  to->vx[to_row] = from->vx[from_row];
+  to->vy[to_row] = from->vy[from_row];
+  to->fx[to_row] = from->fx[from_row];
+  to->fy[to_row] = from->fy[from_row];
+  to->jx[to_row] = from->jx[from_row];
+  to->jy[to_row] = from->jy[from_row];
+  to->inv_mass[to_row] = from->inv_mass[from_row];
+  to->versions[to_row] = from->versions[from_row];
+  to->filters[to_row] = from->filters[from_row];
+  to->flags[to_row] = from->flags[from_row];
+  to->still_ticks[to_row] = from->still_ticks[from_row];
+  to->bodies[to_row] = from->bodies[from_row];
+  to->bodies[to_row]->store = to;
+  to->bodies[to_row]->row = to_row;
+}
+
+static void swap_doubles(double *values, size_t i, size_t j) {
+  double value = values[i];
+  values[i] = values[j];
+  values[j] = value;
+}
+
+/**
+ * Swaps two rows of a store, and points their bodies at their new places.
+ */
+static void swap_rows(body_store_t *store, size_t row1, size_t row2) {
+  if (row1 == row2) {
+    return;
+  }
+  swap_doubles(store->x, row1, row2);
+  swap_doubles(store->y, row1, row2);
+  swap_doubles(store->previous_x, row1, row2);
+  swap_doubles(store->previous_y, row1, row2);
+  swap_doubles(store->vx, row1, row2);
+  swap_doubles(store->vy, row1, row2);
+  swap_doubles(store->fx, row1, row2);
+  swap_doubles(store->fy, row1, row2);
+  swap_doubles(store->jx, row1, row2);
+  swap_doubles(store->jy, row1, row2);
+  swap_doubles(store->inv_mass, row1, row2);
+  uint64_t version = store->versions[row1];
+  store->versions[row1] = store->versions[row2];
+  store->versions[row2] = version;
+  collision_filter_t filter = store->filters[row1];
+  store->filters[row1] = store->filters[row2];
+  store->filters[row2] = filter;
+  uint8_t flags = store->flags[row1];
+  store->flags[row1] = store->flags[row2];
+  store->flags[row2] = flags;
+  uint32_t still_ticks = store->still_ticks[row1];
+  store->still_ticks[row1] = store->still_ticks[row2];
+  store->still_ticks[row2] = still_ticks;
+  body_t *body = store->bodies[row1];
+  store->bodies[row1] = store->bodies[row2];
+  store->bodies[row2] = body;
+  store->bodies[row1]->row = row1;
+  store->bodies[row2]->row = row2;
+}
+
+/**
+ * Returns whether ticking a row could change it.
+ */
+static bool can_move(body_store_t *store, size_t row) {
+  if (store->flags[row] & (BODY_IS_STATIC | BODY_SLEEPING)) {
+    return false;
+  }
+  return store->inv_mass[row] != 0 || store->vx[row] != 0 ||
+         store->vy[row] != 0;
+}
+
+/**
+ * Makes a row's previous centroid its centroid.
+ */
+static void forget_previous(body_store_t *store, size_t row) {
+  store->previous_x[row] = store->x[row];
+  store->previous_y[row] = store->y[row];
+}
+
+/**
+ * Moves a row into the moving or the still part of its store, whichever
+ * it now belongs in.
+ */
+static void update_partition(body_store_t *store, size_t row) {
+  bool moving = can_move(store, row);
+  if (moving && row >= store->num_moving) {
+    swap_rows(store, row, store->num_moving);
+    store->num_moving++;
+  } else if (!moving && row < store->num_moving) {
+    forget_previous(store, row);
+    store->num_moving--;
+    swap_rows(store, row, store->num_moving);
+  }
+}
+
+/**
+ * Wakes a row if it is asleep.
+ */
+static void wake_row(body_store_t *store, size_t row) {
+  if (store->flags[row] & BODY_SLEEPING) {
+    store->flags[row] &= ~BODY_SLEEPING;
+    store->still_ticks[row] = 0;
+    update_partition(store, row);
+  }
+}
+
+/**
+ * Counts another tick for a moving dynamic row that is slower than the
+ * store's sleep speed, and puts it to sleep once it has been slow for long
+ * enough, moving it out of the moving part.
+ */
+static void update_sleep(body_store_t *store, size_t row) {
+  double speed_squared =
+      store->vx[row] * store->vx[row] + store->vy[row] * store->vy[row];
+  if ((store->flags[row] & BODY_IS_KINEMATIC) ||
+      speed_squared >= store->sleep_speed * store->sleep_speed) {
+    store->still_ticks[row] = 0;
+    return;
+  }
+  if (++store->still_ticks[row] < store->sleep_ticks) {
+    return;
+  }
+  store->flags[row] |= BODY_SLEEPING;
+  store->vx[row] = 0;
+  store->vy[row] = 0;
+  forget_previous(store, row);
+  store->num_moving--;
+  swap_rows(store, row, store->num_moving);
+}
+
+/**
+ * Removes a row from a store, moving other rows into its place so both
+ * parts of the store stay dense.
+ */
+static void remove_row(body_store_t *store, size_t row) {
+  if (row < store->num_moving) {
+    store->num_moving--;
+    swap_rows(store, row, store->num_moving);
+    row = store->num_moving;
+  }
+  size_t last = store->size - 1;
+  if (row != last) {
+    copy_row(store, row, store, last);
+  }
+  store->size--;
+}
+
+/**
+ * Appends an empty row to a store, growing it if it is full.
+ *
+ * @return the new row
+ */
+static size_t add_row(body_store_t *store) {
+  if (store->size == store->capacity) {
+    resize_store(store, store->capacity * 2);
+  }
+  return store->size++;
+}
+
+void body_store_add(body_store_t *store, body_t *body) {
+  assert(body->owns_store);
+  body_store_t *own = body->store;
+  copy_row(store, add_row(store), own, body->row);
+  update_partition(store, body->row);
+  if (body_is_removed(body)) {
+    add_removed(store, body);
+  }
+  body->owns_store = false;
+  own->size = 0;
+  own->num_moving = 0;
+  body_store_free(own);
+}
+
+void body_store_tick(body_store_t *store, double dt) {
+  size_t i = 0;
+
+#if defined(__AVX__)
+  __m256d dt4 = _mm256_set1_pd(dt);
+  __m256d half_dt4 = _mm256_set1_pd(dt / 2);
+  __m256d zero = _mm256_setzero_pd();
+  for (; i + 4 <= store->num_moving; i += 4) {
+    __m256d inv_mass = _mm256_loadu_pd(&store->inv_mass[i]);
+    __m256d vx = _mm256_loadu_pd(&store->vx[i]);
+    __m256d vy = _mm256_loadu_pd(&store->vy[i]);
+    __m256d dvx = _mm256_add_pd(_mm256_mul_pd(_mm256_loadu_pd(&store->fx[i]),
+                                              dt4),
+                                _mm256_loadu_pd(&store->jx[i]));
+    __m256d dvy = _mm256_add_pd(_mm256_mul_pd(_mm256_loadu_pd(&store->fy[i]),
+                                              dt4),
+                                _mm256_loadu_pd(&store->jy[i]));
+    __m256d new_vx = _mm256_add_pd(vx, _mm256_mul_pd(dvx, inv_mass));
+    __m256d new_vy = _mm256_add_pd(vy, _mm256_mul_pd(dvy, inv_mass));
+    __m256d x = _mm256_loadu_pd(&store->x[i]);
+    __m256d y = _mm256_loadu_pd(&store->y[i]);
+    _mm256_storeu_pd(&store->previous_x[i], x);
+    _mm256_storeu_pd(&store->previous_y[i], y);
+    _mm256_storeu_pd(&store->x[i],
+                     _mm256_add_pd(x, _mm256_mul_pd(_mm256_add_pd(vx, new_vx),
+                                                    half_dt4)));
+    _mm256_storeu_pd(&store->y[i],
+                     _mm256_add_pd(y, _mm256_mul_pd(_mm256_add_pd(vy, new_vy),
+                                                    half_dt4)));
+    _mm256_storeu_pd(&store->vx[i], new_vx);
+    _mm256_storeu_pd(&store->vy[i], new_vy);
+    _mm256_storeu_pd(&store->fx[i], zero);
+    _mm256_storeu_pd(&store->fy[i], zero);
+    _mm256_storeu_pd(&store->jx[i], zero);
+    _mm256_storeu_pd(&store->jy[i], zero);
+  }
+#elif defined(__SSE2__)
+  __m128d dt2 = _mm_set1_pd(dt);
+  __m128d half_dt2 = _mm_set1_pd(dt / 2);
+  __m128d zero = _mm_setzero_pd();
+  for (; i + 2 <= store->num_moving; i += 2) {
+    __m128d inv_mass = _mm_loadu_pd(&store->inv_mass[i]);
+    __m128d vx = _mm_loadu_pd(&store->vx[i]);
+    __m128d vy = _mm_loadu_pd(&store->vy[i]);
+    __m128d dvx = _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(&store->fx[i]), dt2),
+                             _mm_loadu_pd(&store->jx[i]));
+    __m128d dvy = _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(&store->fy[i]), dt2),
+                             _mm_loadu_pd(&store->jy[i]));
+    __m128d new_vx = _mm_add_pd(vx, _mm_mul_pd(dvx, inv_mass));
+    __m128d new_vy = _mm_add_pd(vy, _mm_mul_pd(dvy, inv_mass));
+    __m128d x = _mm_loadu_pd(&store->x[i]);
+    __m128d y = _mm_loadu_pd(&store->y[i]);
+    _mm_storeu_pd(&store->previous_x[i], x);
+    _mm_storeu_pd(&store->previous_y[i], y);
+    _mm_storeu_pd(&store->x[i],
+                  _mm_add_pd(x, _mm_mul_pd(_mm_add_pd(vx, new_vx), half_dt2)));
+    _mm_storeu_pd(&store->y[i],
+                  _mm_add_pd(y, _mm_mul_pd(_mm_add_pd(vy, new_vy), half_dt2)));
+    _mm_storeu_pd(&store->vx[i], new_vx);
+    _mm_storeu_pd(&store->vy[i], new_vy);
+    _mm_storeu_pd(&store->fx[i], zero);
+    _mm_storeu_pd(&store->fy[i], zero);
+    _mm_storeu_pd(&store->jx[i], zero);
+    _mm_storeu_pd(&store->jy[i], zero);
+  }
+#elif defined(__wasm_simd128__)
+  v128_t dt2 = wasm_f64x2_splat(dt);
+  v128_t half_dt2 = wasm_f64x2_splat(dt / 2);
+  v128_t zero = wasm_f64x2_splat(0);
+  for (; i + 2 <= store->num_moving; i += 2) {
+    v128_t inv_mass = wasm_v128_load(&store->inv_mass[i]);
+    v128_t vx = wasm_v128_load(&store->vx[i]);
+    v128_t vy = wasm_v128_load(&store->vy[i]);
+    v128_t dvx = wasm_f64x2_add(
+        wasm_f64x2_mul(wasm_v128_load(&store->fx[i]), dt2),
+        wasm_v128_load(&store->jx[i]));
+    v128_t dvy = wasm_f64x2_add(
+        wasm_f64x2_mul(wasm_v128_load(&store->fy[i]), dt2),
+        wasm_v128_load(&store->jy[i]));
+    v128_t new_vx = wasm_f64x2_add(vx, wasm_f64x2_mul(dvx, inv_mass));
+    v128_t new_vy = wasm_f64x2_add(vy, wasm_f64x2_mul(dvy, inv_mass));
+    v128_t x = wasm_v128_load(&store->x[i]);
+    v128_t y = wasm_v128_load(&store->y[i]);
+    wasm_v128_store(&store->previous_x[i], x);
+    wasm_v128_store(&store->previous_y[i], y);
+    wasm_v128_store(&store->x[i],
+                    wasm_f64x2_add(x, wasm_f64x2_mul(wasm_f64x2_add(vx, new_vx),
+                                                     half_dt2)));
+    wasm_v128_store(&store->y[i],
+                    wasm_f64x2_add(y, wasm_f64x2_mul(wasm_f64x2_add(vy, new_vy),
+                                                     half_dt2)));
+    wasm_v128_store(&store->vx[i], new_vx);
+    wasm_v128_store(&store->vy[i], new_vy);
+    wasm_v128_store(&store->fx[i], zero);
+    wasm_v128_store(&store->fy[i], zero);
+    wasm_v128_store(&store->jx[i], zero);
+    wasm_v128_store(&store->jy[i], zero);
+  }
+#endif
+
+  for (; i < store->num_moving; i++) {
+    double vx = store->vx[i] + (store->fx[i] * dt + store->jx[i]) *
+                                   store->inv_mass[i];
+    double vy = store->vy[i] + (store->fy[i] * dt + store->jy[i]) *
+                                   store->inv_mass[i];
+    store->previous_x[i] = store->x[i];
+    store->previous_y[i] = store->y[i];
+    store->x[i] += (store->vx[i] + vx) * (dt / 2);
+    store->y[i] += (store->vy[i] + vy) * (dt / 2);
+    store->vx[i] = vx;
+    store->vy[i] = vy;
+    store->fx[i] = 0;
+    store->fy[i] = 0;
+    store->jx[i] = 0;
+    store->jy[i] = 0;
+  }
+
+  // the moving rows that really moved get new versions
+  for (size_t row = 0; row < store->num_moving; row++) {
+    bool moved = store->x[row] != store->previous_x[row] ||
+                 store->y[row] != store->previous_y[row];
+    store->versions[row] = moved ? NEXT_VERSION + row : store->versions[row];
+  }
+  NEXT_VERSION += store->num_moving;
+
+  // visit the rows from the back, so a row put to sleep is swapped with one
+  // that has already been visited
+  if (store->sleep_ticks > 0) {
+    for (size_t row = store->num_moving; row-- > 0;) {
+      update_sleep(store, row);
+    }
+  }
+}
+
+void body_store_set_sleeping(body_store_t *store, double speed,
+                             size_t ticks) {
+  store->sleep_speed = speed;
+  store->sleep_ticks = ticks;
+}
+
+body_t *const *body_store_get_removed(body_store_t *store, size_t *size) {
+  *size = store->num_removed;
+  return store->removed;
+}
+
+void body_store_clear_removed(body_store_t *store) { store->num_removed = 0; }
+
+void body_store_free(body_store_t *store) {
+  assert(store->size == 0);
+  free(store->removed);
+  free(store->x);
+  free(store->y);
+  free(store->previous_x);
+  free(store->previous_y);
+  free(store->vx);
+  free(store->vy);
+  free(store->fx);
+  free(store->fy);
+  free(store->jx);
+  free(store->jy);
+  free(store->inv_mass);
+  free(store->versions);
+  free(store->filters);
+  free(store->flags);
+  free(store->still_ticks);
+  free(store->bodies);
+  free(store);
+}
+
+/**
+ * Computes a polygon's centroid.
+ * See https://en.wikipedia.org/wiki/Centroid#Of_a_polygon.
+ */
+static vector_t polygon_centroid(list_t *shape) {
+  size_t size = list_size(shape);
+  double area = 0;
+  vector_t sum = VEC_ZERO;
+  for (size_t i = 0; i < size; i++) {
+    vector_t v1 = *(vector_t *)list_get(shape, i);
+    vector_t v2 = *(vector_t *)list_get(shape, (i + 1) % size);
+    double cross = vec_cross(v1, v2);
+    area += cross / 2;
+    sum = vec_add(sum, vec_multiply(cross, vec_add(v1, v2)));
+  }
+  return vec_multiply(1 / (6 * area), sum);
+}
+
+/**
+ * Returns the inverse of a mass. Masses too large to be told apart from
+ * infinity, such as __DBL_MAX__, have an inverse of exactly 0 rather than a
+ * tiny one, so forces never move them and ticks can skip them.
+ */
+static double inverse_mass(double mass) {
+  return mass == INFINITY || mass >= __DBL_MAX__ ? 0 : 1 / mass;
+}
+
+body_t *body_init(list_t *shape, double mass, color_t color) {
+  return body_init_with_info(shape, mass, color, NULL, NULL);
+}
+
+body_t *body_init_with_info(list_t *shape, double mass, color_t color,
+                            void *info, free_func_t info_freer) {
+  body_t *body = malloc(sizeof(body_t));
+  assert(body);
+  body->size = list_size(shape);
+  body->local = malloc(body->size * sizeof(vector_t));
+  assert(body->local);
+  vector_t centroid = polygon_centroid(shape);
+  for (size_t i = 0; i < body->size; i++) {
+    body->local[i] = vec_subtract(*(vector_t *)list_get(shape, i), centroid);
+  }
+  list_free(shape);
+
+  body->rotation = 0;
+  body->mass = mass;
+  body->color = color;
+  body->info = info;
+  body->info_freer = info_freer;
+  body->local_shape = NULL;
+  body->shape_cache = NULL;
+
+  body_store_t *store = body_store_init(1);
+  size_t row = add_row(store);
+  store->x[row] = centroid.x;
+  store->y[row] = centroid.y;
+  store->previous_x[row] = centroid.x;
+  store->previous_y[row] = centroid.y;
+  store->vx[row] = 0;
+  store->vy[row] = 0;
+  store->fx[row] = 0;
+  store->fy[row] = 0;
+  store->jx[row] = 0;
+  store->jy[row] = 0;
+  store->inv_mass[row] = inverse_mass(mass);
+  store->versions[row] = NEXT_VERSION++;
+  store->filters[row] = COLLISION_FILTER_ALL;
+  store->flags[row] = 0;
+  store->still_ticks[row] = 0;
+  store->bodies[row] = body;
+  body->store = store;
+  body->row = row;
+  body->owns_store = true;
+  update_partition(store, row);
+  return body;
+}
+
+list_t *body_get_shape(body_t *body) {
+  list_t *shape = list_init(body->size, free);
+  vector_t centroid = body_get_centroid(body);
+  for (size_t i = 0; i < body->size; i++) {
+    vector_t *vertex = malloc(sizeof(vector_t));
+    assert(vertex);
+    *vertex = vec_add(centroid, vec_rotate(body->local[i], body->rotation));
+    list_add(shape, vertex);
+  }
+  return shape;
+}
+
+const vector_t *body_get_local_vertices(body_t *body, size_t *size) {
+  *size = body->size;
+  return body->local;
+}
+
+void body_set_local_shape(body_t *body, local_shape_t *shape) {
+  assert(local_shape_size(shape) == body->size);
+  local_shape_retain(shape);
+  if (body->local_shape != NULL) {
+    local_shape_release(body->local_shape);
+  }
+  body->local_shape = shape;
+  // the cached world-space shape was placed from the body's own vertices
+  body->store->versions[body->row] = NEXT_VERSION++;
+}
+
+local_shape_t *body_get_local_shape(body_t *body) {
+  return body->local_shape;
+}
+
+shape_cache_t *body_get_shape_cache(body_t *body) {
+  return body->shape_cache;
+}
+
+void body_set_shape_cache(body_t *body, shape_cache_t *cache) {
+  assert(body->shape_cache == NULL);
+  body->shape_cache = cache;
+}
+
+void *body_get_info(body_t *body) { return body->info; }
+
+vector_t body_get_centroid(body_t *body) {
+  return (vector_t){.x = body->store->x[body->row],
+                    .y = body->store->y[body->row]};
+}
+
+vector_t body_get_previous_centroid(body_t *body) {
+  return (vector_t){.x = body->store->previous_x[body->row],
+                    .y = body->store->previous_y[body->row]};
+}
+
+void body_set_centroid(body_t *body, vector_t x) {
+  body_store_t *store = body->store;
+  size_t row = body->row;
+  store->x[row] = x.x;
+  store->y[row] = x.y;
+  store->versions[row] = NEXT_VERSION++;
+  if (row >= store->num_moving) {
+    forget_previous(store, row);
+  }
+  wake_row(store, row);
+}
+
+vector_t body_get_velocity(body_t *body) {
+  return (vector_t){.x = body->store->vx[body->row],
+                    .y = body->store->vy[body->row]};
+}
+
+void body_set_velocity(body_t *body, vector_t v) {
+  body_store_t *store = body->store;
+  size_t row = body->row;
+  if (store->flags[row] & BODY_IS_STATIC) {
+    return;
+  }
+  store->vx[row] = v.x;
+  store->vy[row] = v.y;
+  if (v.x != 0 || v.y != 0) {
+    wake_row(store, row);
+  }
+  // waking may have moved the row
+  update_partition(store, body->row);
+}
+
+body_kind_t body_get_kind(body_t *body) {
+  uint8_t flags = body->store->flags[body->row];
+  if (flags & BODY_IS_STATIC) {
+    return BODY_STATIC;
+  }
+  return flags & BODY_IS_KINEMATIC ? BODY_KINEMATIC : BODY_DYNAMIC;
+}
+
+void body_set_kind(body_t *body, body_kind_t kind) {
+  body_store_t *store = body->store;
+  size_t row = body->row;
+  store->flags[row] &= ~(BODY_IS_STATIC | BODY_IS_KINEMATIC | BODY_SLEEPING);
+  if (kind == BODY_STATIC) {
+    store->flags[row] |= BODY_IS_STATIC;
+    store->vx[row] = 0;
+    store->vy[row] = 0;
+  } else if (kind == BODY_KINEMATIC) {
+    store->flags[row] |= BODY_IS_KINEMATIC;
+  }
+  store->inv_mass[row] = kind == BODY_DYNAMIC ? inverse_mass(body->mass) : 0;
+  store->still_ticks[row] = 0;
+  body_reset(body);
+  update_partition(store, row);
+}
+
+collision_filter_t body_get_filter(body_t *body) {
+  return body->store->filters[body->row];
+}
+
+void body_set_filter(body_t *body, collision_filter_t filter) {
+  body->store->filters[body->row] = filter;
+}
+
+bool body_is_sleeping(body_t *body) {
+  return body->store->flags[body->row] & BODY_SLEEPING;
+}
+
+void body_wake(body_t *body) { wake_row(body->store, body->row); }
+
+void body_set_continuous(body_t *body, bool continuous) {
+  if (continuous) {
+    body->store->flags[body->row] |= BODY_CONTINUOUS;
+  } else {
+    body->store->flags[body->row] &= ~BODY_CONTINUOUS;
+  }
+}
+
+bool body_is_continuous(body_t *body) {
+  return body->store->flags[body->row] & BODY_CONTINUOUS;
+}
+
+double body_area(body_t *body) {
+  double area = 0;
+  for (size_t i = 0; i < body->size; i++) {
+    area += vec_cross(body->local[i], body->local[(i + 1) % body->size]);
+  }
+  return fabs(area) / 2;
+}
+
+color_t body_get_color(body_t *body) { return body->color; }
+
+void body_set_color(body_t *body, color_t color) { body->color = color; }
+
+double body_get_rotation(body_t *body) { return body->rotation; }
+
+void body_set_rotation(body_t *body, double angle) {
+  body->rotation = angle;
+  body->store->versions[body->row] = NEXT_VERSION++;
+}
+
+uint64_t body_get_version(body_t *body) {
+  return body->store->versions[body->row];
+}
+
+void body_tick(body_t *body, double dt) {
+  body_store_t *store = body->store;
+  size_t row = body->row;
+  double vx = store->vx[row] + (store->fx[row] * dt + store->jx[row]) *
+                                   store->inv_mass[row];
+  double vy = store->vy[row] + (store->fy[row] * dt + store->jy[row]) *
+                                   store->inv_mass[row];
+  // the same arithmetic as body_store_tick(), written straight into the row
+  // so the previous centroid is kept and a sleeping body is not woken
+  store->previous_x[row] = store->x[row];
+  store->previous_y[row] = store->y[row];
+  store->x[row] += (store->vx[row] + vx) * (dt / 2);
+  store->y[row] += (store->vy[row] + vy) * (dt / 2);
+  store->vx[row] = vx;
+  store->vy[row] = vy;
+  store->versions[row] = NEXT_VERSION++;
+  body_reset(body);
+}
+
+double body_get_mass(body_t *body) { return body->mass; }
+
+void body_add_force(body_t *body, vector_t force) {
+  body->store->fx[body->row] += force.x;
+  body->store->fy[body->row] += force.y;
+  if (force.x != 0 || force.y != 0) {
+    wake_row(body->store, body->row);
+  }
+}
+
+void body_add_impulse(body_t *body, vector_t impulse) {
+  body->store->jx[body->row] += impulse.x;
+  body->store->jy[body->row] += impulse.y;
+  if (impulse.x != 0 || impulse.y != 0) {
+    wake_row(body->store, body->row);
+  }
+}
+
+void body_reset(body_t *body) {
+  body->store->fx[body->row] = 0;
+  body->store->fy[body->row] = 0;
+  body->store->jx[body->row] = 0;
+  body->store->jy[body->row] = 0;
+}
+
+void body_remove(body_t *body) {
+  if (!body_is_removed(body)) {
+    body->store->flags[body->row] |= BODY_REMOVED;
+    add_removed(body->store, body);
+  }
+}
+
+bool body_is_removed(body_t *body) {
+  return body->store->flags[body->row] & BODY_REMOVED;
+}
+
+void body_free(body_t *body) {
+  remove_row(body->store, body->row);
+  if (body->owns_store) {
+    body_store_free(body->store);
+  }
+  if (body->info_freer != NULL) {
+    body->info_freer(body->info);
+  }
+  if (body->shape_cache != NULL) {
+    shape_cache_free(body->shape_cache);
+  }
+  if (body->local_shape != NULL) {
+    local_shape_release(body->local_shape);
+  }
+  free(body->local);
+  free(body);
+}
@@ -0,0 +1,123 @@
+#include "body_handle.h"
+#include "hash_map.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+/** Initial capacity of the pool's slots and of its body index */
+static const size_t INIT_SLOTS_CAPACITY = 32;
+/** Marks the end of the free list */
+static const uint32_t NO_SLOT = UINT32_MAX;
+
+const body_handle_t BODY_HANDLE_NONE = {.index = 0, .generation = 0};
+
+/**
+ * A slot of the pool. A slot with no body is on the free list.
+ * Generations start at 1, so no slot ever matches BODY_HANDLE_NONE.
+ */
+typedef struct {
+  body_t *body;
+  uint32_t generation;
+  uint32_t next_free;
+} slot_t;
+
+static slot_t *SLOTS = NULL;
+static size_t NUM_SLOTS = 0;
+static size_t SLOTS_CAPACITY = 0;
+static uint32_t FREE_SLOT = UINT32_MAX;
+
+/**
+ * Map from body to the slot holding it, so a body's handle is found without
+ * searching the pool.
+ */
+static hash_map_t *INDEX = NULL;
+
+/**
+ * Empties a pool slot, invalidating its handles, and puts it on the free
+ * list.
+ */
+static void free_slot(uint32_t index) {
+  slot_t *slot = &SLOTS[index];
+  slot->body = NULL;
+  if (++slot->generation == 0) {
+    slot->generation = 1;
+  }
+  slot->next_free = FREE_SLOT;
+  FREE_SLOT = index;
+}
+
+body_handle_t body_handle_issue(body_t *body) {
+  assert(body != NULL);
+  if (INDEX == NULL) {
+    INDEX = hash_map_init(INIT_SLOTS_CAPACITY);
+  }
+  size_t found = hash_map_get(INDEX, (uintptr_t)body);
+  if (found != HASH_MAP_NONE) {
+    return (body_handle_t){.index = found,
+                           .generation = SLOTS[found].generation};
+  }
+
+  uint32_t index = FREE_SLOT;
+  if (index != NO_SLOT) {
+    FREE_SLOT = SLOTS[index].next_free;
+  } else {
+    if (NUM_SLOTS == SLOTS_CAPACITY) {
+      SLOTS_CAPACITY =
+          SLOTS_CAPACITY ? SLOTS_CAPACITY * 2 : INIT_SLOTS_CAPACITY;
+      SLOTS = realloc(SLOTS, SLOTS_CAPACITY * sizeof(slot_t));
+      assert(SLOTS);
+    }
+    assert(NUM_SLOTS < NO_SLOT);
+    index = NUM_SLOTS++;
+    SLOTS[index].generation = 1;
+  }
+  SLOTS[index].body = body;
+  hash_map_put(INDEX, (uintptr_t)body, index);
+  return (body_handle_t){.index = index,
+                         .generation = SLOTS[index].generation};
+}
+
+body_t *body_handle_resolve(body_handle_t handle) {
+  if (handle.index >= NUM_SLOTS ||
+      SLOTS[handle.index].generation != handle.generation) {
+    return NULL;
+  }
+  return SLOTS[handle.index].body;
+}
+
+bool body_handle_is_none(body_handle_t handle) {
+  return handle.generation == BODY_HANDLE_NONE.generation;
+}
+
+void body_handle_revoke(body_t *body) {
+  if (INDEX == NULL) {
+    return;
+  }
+  size_t index = hash_map_remove(INDEX, (uintptr_t)body);
+  if (index != HASH_MAP_NONE) {
+    free_slot(index);
+  }
+}
+
+void body_handle_clear(void) {
+  for (size_t i = 0; i < NUM_SLOTS; i++) {
+    if (SLOTS[i].body != NULL) {
+      free_slot(i);
+    }
+  }
+  if (INDEX != NULL) {
+    hash_map_clear(INDEX);
+  }
+}
+
+void body_handle_destroy(void) {
+  free(SLOTS);
+  SLOTS = NULL;
+  NUM_SLOTS = 0;
+  SLOTS_CAPACITY = 0;
+  FREE_SLOT = NO_SLOT;
+  if (INDEX != NULL) {
+    hash_map_free(INDEX);
+    INDEX = NULL;
+  }
+}
@@ -0,0 +1,273 @@
+#include "bvh.h"
+#include "collision.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+/** Initial capacity of the lists returned by queries */
+static const size_t INIT_RESULT_CAPACITY = 4;
+
+/**
+ * A node of the hierarchy.
+ * Leaves hold a body; internal nodes hold the indices of their children.
+ * An internal node's filter is the union of its children's, so a query that
+ * cannot collide with it cannot collide with anything below it.
+ */
+typedef struct {
+  vector_t min;
+  vector_t max;
+  collision_filter_t filter;
+  body_t *body;
+  size_t left;
+  size_t right;
+} node_t;
+
+/**
+ * A body being sorted into the hierarchy, with its bounds and their center.
+ */
+typedef struct {
+  body_t *body;
+  collision_filter_t filter;
+  vector_t min;
+  vector_t max;
+  vector_t center;
+} item_t;
+
+struct bvh {
+  /** The nodes, with the root at index 0 */
+  node_t *nodes;
+  size_t num_nodes;
+};
+
+/**
+ * Orders items by the x-coordinate of their centers, for qsort().
+ */
+static int compare_center_x(const void *a, const void *b) {
+  double x1 = ((const item_t *)a)->center.x;
+  double x2 = ((const item_t *)b)->center.x;
+  return (x1 > x2) - (x1 < x2);
+}
+
+/**
+ * Orders items by the y-coordinate of their centers, for qsort().
+ */
+static int compare_center_y(const void *a, const void *b) {
+  double y1 = ((const item_t *)a)->center.y;
+  double y2 = ((const item_t *)b)->center.y;
+  return (y1 > y2) - (y1 < y2);
+}
+
+/**
+ * Builds the subtree over a range of items, splitting at the median center
+ * along whichever axis the centers are most spread out on.
+ *
+ * @param bvh the hierarchy whose node array to fill
+ * @param items the items to build the subtree over; reordered in place
+ * @param count the number of items, at least 1
+ * @return the index of the subtree's root node
+ */
+static size_t build(bvh_t *bvh, item_t *items, size_t count) {
+  size_t index = bvh->num_nodes++;
+  node_t *node = &bvh->nodes[index];
+  node->min = items[0].min;
+  node->max = items[0].max;
+  node->filter = items[0].filter;
+  vector_t center_min = items[0].center;
+  vector_t center_max = items[0].center;
+  for (size_t i = 1; i < count; i++) {
+    node->min.x = fmin(node->min.x, items[i].min.x);
+    node->min.y = fmin(node->min.y, items[i].min.y);
+    node->max.x = fmax(node->max.x, items[i].max.x);
+    node->max.y = fmax(node->max.y, items[i].max.y);
+    node->filter.layer |= items[i].filter.layer;
+    node->filter.mask |= items[i].filter.mask;
+    center_min.x = fmin(center_min.x, items[i].center.x);
+    center_min.y = fmin(center_min.y, items[i].center.y);
+    center_max.x = fmax(center_max.x, items[i].center.x);
+    center_max.y = fmax(center_max.y, items[i].center.y);
+  }
+
+  if (count == 1) {
+    node->body = items[0].body;
+    return index;
+  }
+
+  node->body = NULL;
+  bool split_x = center_max.x - center_min.x >= center_max.y - center_min.y;
+  qsort(items, count, sizeof(item_t),
+        split_x ? compare_center_x : compare_center_y);
+  size_t half = count / 2;
+  // node may move if a child is built first, so only store indices into it
+  size_t left = build(bvh, items, half);
+  size_t right = build(bvh, items + half, count - half);
+  bvh->nodes[index].left = left;
+  bvh->nodes[index].right = right;
+  return index;
+}
+
+bvh_t *bvh_init(list_t *bodies) {
+  size_t count = list_size(bodies);
+  bvh_t *bvh = malloc(sizeof(bvh_t));
+  assert(bvh);
+  bvh->num_nodes = 0;
+  // a binary tree with one body per leaf has 2n - 1 nodes
+  bvh->nodes = malloc(sizeof(node_t) * (count > 0 ? 2 * count - 1 : 1));
+  assert(bvh->nodes);
+  if (count == 0) {
+    return bvh;
+  }
+
+  item_t *items = malloc(sizeof(item_t) * count);
+  assert(items);
+  for (size_t i = 0; i < count; i++) {
+    items[i].body = list_get(bodies, i);
+    items[i].filter = body_get_filter(items[i].body);
+    find_bounding_box(items[i].body, &items[i].min, &items[i].max);
+    items[i].center = vec_multiply(0.5, vec_add(items[i].min, items[i].max));
+  }
+  build(bvh, items, count);
+  free(items);
+  return bvh;
+}
+
+/**
+ * Adds the bodies of every leaf under a node that overlaps a region and can
+ * collide with a filter.
+ */
+static void query(bvh_t *bvh, size_t index, vector_t min, vector_t max,
+                  collision_filter_t filter, list_t *bodies) {
+  node_t *node = &bvh->nodes[index];
+  if (!can_collide(node->filter, filter)) {
+    return;
+  }
+  if (node->min.x > max.x || min.x > node->max.x || node->min.y > max.y ||
+      min.y > node->max.y) {
+    return;
+  }
+  if (node->body != NULL) {
+    list_add(bodies, node->body);
+    return;
+  }
+  query(bvh, node->left, min, max, filter, bodies);
+  query(bvh, node->right, min, max, filter, bodies);
+}
+
+list_t *bvh_query(bvh_t *bvh, vector_t min, vector_t max,
+                  collision_filter_t filter) {
+  list_t *bodies = list_init(INIT_RESULT_CAPACITY, NULL);
+  if (bvh->num_nodes > 0) {
+    query(bvh, 0, min, max, filter, bodies);
+  }
+  return bodies;
+}
+
+list_t *bvh_query_point(bvh_t *bvh, vector_t point,
+                        collision_filter_t filter) {
+  return bvh_query(bvh, point, point, filter);
+}
+
+/**
+ * Intersects a ray with one axis of a box, narrowing the range of times
+ * during which the ray is inside the box.
+ *
+ * @param origin the ray's start along this axis
+ * @param direction the ray's direction along this axis
+ * @param min the box's lower bound along this axis
+ * @param max the box's upper bound along this axis
+ * @param t_enter the latest entry time so far; updated in place
+ * @param t_exit the earliest exit time so far; updated in place
+ */
+static void clip_slab(double origin, double direction, double min, double max,
+                      double *t_enter, double *t_exit) {
+  if (direction == 0) {
+    if (origin < min || origin > max) {
+      *t_enter = INFINITY;
+    }
+    return;
+  }
+  double t1 = (min - origin) / direction;
+  double t2 = (max - origin) / direction;
+  *t_enter = fmax(*t_enter, fmin(t1, t2));
+  *t_exit = fmin(*t_exit, fmax(t1, t2));
+}
+
+/**
+ * Returns the time at which a ray enters a node's bounds,
+ * or INFINITY if it misses them within [0, max_time] or cannot collide with
+ * anything under the node.
+ */
+static double ray_enter_time(node_t *node, vector_t origin,
+                             vector_t direction, double max_time,
+                             collision_filter_t filter) {
+  if (!can_collide(node->filter, filter)) {
+    return INFINITY;
+  }
+  double t_enter = 0;
+  double t_exit = max_time;
+  clip_slab(origin.x, direction.x, node->min.x, node->max.x, &t_enter,
+            &t_exit);
+  clip_slab(origin.y, direction.y, node->min.y, node->max.y, &t_enter,
+            &t_exit);
+  return t_enter <= t_exit ? t_enter : INFINITY;
+}
+
+/**
+ * Finds the first leaf under a node hit by a ray before the best time so far,
+ * visiting the nearer child first so the farther one can often be skipped.
+ */
+static void raycast(bvh_t *bvh, size_t index, vector_t origin,
+                    vector_t direction, collision_filter_t filter,
+                    double *best_time, body_t **best) {
+  node_t *node = &bvh->nodes[index];
+  if (node->body != NULL) {
+    double time = ray_enter_time(node, origin, direction, *best_time, filter);
+    if (time <= *best_time) {
+      *best = node->body;
+      *best_time = time;
+    }
+    return;
+  }
+
+  size_t near = node->left;
+  size_t far = node->right;
+  double near_time = ray_enter_time(&bvh->nodes[near], origin, direction,
+                                    *best_time, filter);
+  double far_time = ray_enter_time(&bvh->nodes[far], origin, direction,
+                                   *best_time, filter);
+  if (far_time < near_time) {
+    size_t temp_index = near;
+    near = far;
+    far = temp_index;
+    double temp_time = near_time;
+    near_time = far_time;
+    far_time = temp_time;
+  }
+  if (near_time <= *best_time) {
+    raycast(bvh, near, origin, direction, filter, best_time, best);
+  }
+  if (far_time <= *best_time) {
+    raycast(bvh, far, origin, direction, filter, best_time, best);
+  }
+}
+
+body_t *bvh_raycast(bvh_t *bvh, vector_t origin, vector_t direction,
+                    double max_time, collision_filter_t filter,
+                    double *time) {
+  body_t *best = NULL;
+  double best_time = max_time;
+  if (bvh->num_nodes > 0 &&
+      ray_enter_time(&bvh->nodes[0], origin, direction, max_time, filter) <=
+          max_time) {
+    raycast(bvh, 0, origin, direction, filter, &best_time, &best);
+  }
+  if (best != NULL) {
+    *time = best_time;
+  }
+  return best;
+}
+
+void bvh_free(bvh_t *bvh) {
+  free(bvh->nodes);
+  free(bvh);
+}
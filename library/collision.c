@@ -1,46 +1,148 @@
 #include "collision.h"
 #include "body.h"
+#include "hash_map.h"
+#include "shape_view.h"
 
 #include <assert.h>
 #include <math.h>
+#include <stdint.h>
 #include <stdlib.h>
 
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
+
+/** Relative difference allowed between the aspect ratios of two ellipses
+ * compared as circles */
+static const double ELLIPSE_TOLERANCE = 1e-6;
+/** Number of pairs a collision cache remembers; must be a power of two */
+static const size_t COLLISION_CACHE_SIZE = 1024;
+/** Initial capacity of a collision cache's array of bodies, and of each
+ * body's list of slots */
+static const size_t INIT_CACHE_BODIES_CAPACITY = 32;
+static const size_t INIT_BODY_SLOTS_CAPACITY = 4;
+/** Most simplex updates GJK makes before giving up on a pair */
+static const size_t GJK_MAX_ITERATIONS = 64;
+/** Most vertices EPA grows its polytope to */
+static const size_t EPA_MAX_VERTICES = 64;
+/** How close EPA must get to the Minkowski difference's boundary to stop */
+static const double EPA_TOLERANCE = 1e-9;
+
 /**
- * Returns a list of vectors representing the edges of a shape.
+ * Returns the unit normal of an edge of a shape, computed on the fly.
+ * Edge i runs from vertex i to vertex i + 1 (wrapping around), and its normal
+ * is the edge rotated by 90 degrees counterclockwise.
  *
- * @param shape the list of vectors representing the vertices of a shape
- * @return a list of vectors representing the edges of the shape
+ * @param shape the array of vertices of the shape
+ * @param size the number of vertices in the shape
+ * @param i the index of the edge
+ * @return the unit normal of the edge
  */
-static list_t *get_edges(list_t *shape) {
-  list_t *edges = list_init(list_size(shape), free);
+static vector_t get_edge_normal(const vector_t *shape, size_t size, size_t i) {
+  vector_t edge = vec_subtract(shape[i], shape[(i + 1) % size]);
+  vector_t axis = {.x = -edge.y, .y = edge.x};
+  return vec_multiply(1 / vec_get_length(axis), axis);
+}
 
-  for (size_t i = 0; i < list_size(shape); i++) {
-    vector_t *vec = malloc(sizeof(vector_t));
-    assert(vec);
-    *vec =
-        vec_subtract(*(vector_t *)list_get(shape, i % list_size(shape)),
-                     *(vector_t *)list_get(shape, (i + 1) % list_size(shape)));
-    list_add(edges, vec);
+/**
+ * Returns the unit normal of an edge of a shape, from the shape's cached
+ * normals if it has them.
+ *
+ * @param shape the shape
+ * @param i the index of the edge
+ * @return the unit normal of the edge
+ */
+static vector_t get_shape_normal(const collision_shape_t *shape, size_t i) {
+  if (shape->normals != NULL) {
+    return shape->normals[i];
   }
-
-  return edges;
+  return get_edge_normal(shape->vertices, shape->size, i);
 }
 
 /**
  * Returns a vector containing the maximum and minimum length projections given
  * a unit axis and shape.
+ * The coordinates are read as separate x and y arrays so that several vertices
+ * can be projected per instruction: four at a time with AVX, two with SSE2 or
+ * wasm SIMD128, and one at a time otherwise.
+ * Every path computes each projection the same way, so the result does not
+ * depend on which one was compiled in.
  *
- * @param shape the list of vectors representing the vertices of a shape
+ * @param x the x-coordinates of the vertices of the shape
+ * @param y the y-coordinates of the vertices of the shape
+ * @param size the number of vertices in the shape
  * @param unit_axis the unit axis to project eeach vertex on
  * @return a vector in the form (max, min) where `max` is the maximum projection
  * length and `min` is the minimum projection length.
  */
-static vector_t get_max_min_projections(list_t *shape, vector_t unit_axis) {
+static vector_t get_max_min_projections(const double *x, const double *y,
+                                        size_t size, vector_t unit_axis) {
   double min = __DBL_MAX__;
   double max = -__DBL_MAX__;
+  size_t i = 0;
+
+#if defined(__AVX__)
+  __m256d axis_x = _mm256_set1_pd(unit_axis.x);
+  __m256d axis_y = _mm256_set1_pd(unit_axis.y);
+  __m256d mins = _mm256_set1_pd(min);
+  __m256d maxs = _mm256_set1_pd(max);
+  for (; i + 4 <= size; i += 4) {
+    __m256d length =
+        _mm256_add_pd(_mm256_mul_pd(axis_x, _mm256_loadu_pd(&x[i])),
+                      _mm256_mul_pd(axis_y, _mm256_loadu_pd(&y[i])));
+    mins = _mm256_min_pd(mins, length);
+    maxs = _mm256_max_pd(maxs, length);
+  }
+  double lane_mins[4];
+  double lane_maxs[4];
+  _mm256_storeu_pd(lane_mins, mins);
+  _mm256_storeu_pd(lane_maxs, maxs);
+  for (size_t lane = 0; lane < 4; lane++) {
+    min = fmin(min, lane_mins[lane]);
+    max = fmax(max, lane_maxs[lane]);
+  }
+#elif defined(__SSE2__)
+  __m128d axis_x = _mm_set1_pd(unit_axis.x);
+  __m128d axis_y = _mm_set1_pd(unit_axis.y);
+  __m128d mins = _mm_set1_pd(min);
+  __m128d maxs = _mm_set1_pd(max);
+  for (; i + 2 <= size; i += 2) {
+    __m128d length = _mm_add_pd(_mm_mul_pd(axis_x, _mm_loadu_pd(&x[i])),
+                                _mm_mul_pd(axis_y, _mm_loadu_pd(&y[i])));
+    mins = _mm_min_pd(mins, length);
+    maxs = _mm_max_pd(maxs, length);
+  }
+  double lane_mins[2];
+  double lane_maxs[2];
+  _mm_storeu_pd(lane_mins, mins);
+  _mm_storeu_pd(lane_maxs, maxs);
+  min = fmin(lane_mins[0], lane_mins[1]);
+  max = fmax(lane_maxs[0], lane_maxs[1]);
+#elif defined(__wasm_simd128__)
+  v128_t axis_x = wasm_f64x2_splat(unit_axis.x);
+  v128_t axis_y = wasm_f64x2_splat(unit_axis.y);
+  v128_t mins = wasm_f64x2_splat(min);
+  v128_t maxs = wasm_f64x2_splat(max);
+  for (; i + 2 <= size; i += 2) {
+    v128_t length =
+        wasm_f64x2_add(wasm_f64x2_mul(axis_x, wasm_v128_load(&x[i])),
+                       wasm_f64x2_mul(axis_y, wasm_v128_load(&y[i])));
+    mins = wasm_f64x2_min(mins, length);
+    maxs = wasm_f64x2_max(maxs, length);
+  }
+  min = fmin(wasm_f64x2_extract_lane(mins, 0),
+             wasm_f64x2_extract_lane(mins, 1));
+  max = fmax(wasm_f64x2_extract_lane(maxs, 0),
+             wasm_f64x2_extract_lane(maxs, 1));
+#endif
 
-  for (size_t i = 0; i < list_size(shape); i++) {
-    double length = vec_dot(unit_axis, *(vector_t *)list_get(shape, i));
+  // whatever the vector loop left over, or every vertex without SIMD
+  for (; i < size; i++) {
+    double length = unit_axis.x * x[i] + unit_axis.y * y[i];
 
     if (length > max) {
       max = length;
@@ -55,31 +157,31 @@ static vector_t get_max_min_projections(list_t *shape, vector_t unit_axis) {
 }
 
 /**
- * Determines whether two convex polygons intersect.
- * The polygons are given as lists of vertices in counterclockwise order.
+ * Determines whether two convex polygons intersect, testing only the edge
+ * normals of the first polygon.
  * There is an edge between each pair of consecutive vertices,
  * and one between the first vertex and the last vertex.
  *
  * @param shape1 the first shape
  * @param shape2 the second shape
+ * @param min_overlap the smallest overlap found so far; updated in place
  * @return whether the shapes are colliding
  */
-static collision_info_t compare_collision(list_t *shape1, list_t *shape2,
+static collision_info_t compare_collision(const collision_shape_t *shape1,
+                                          const collision_shape_t *shape2,
                                           double *min_overlap) {
-  list_t *edges1 = get_edges(shape1);
   vector_t collision_axis = VEC_ZERO;
 
-  for (size_t i = 0; i < list_size(edges1); i++) {
-    vector_t *edge1 = list_get(edges1, i);
-    vector_t axis = vec_rotate(*edge1, M_PI / 2);
-    vector_t unit_axis = vec_multiply(1 / vec_get_length(axis), axis);
+  for (size_t i = 0; i < shape1->size; i++) {
+    vector_t unit_axis = get_shape_normal(shape1, i);
 
-    vector_t shape1_proj = get_max_min_projections(shape1, unit_axis);
-    vector_t shape2_proj = get_max_min_projections(shape2, unit_axis);
+    vector_t shape1_proj =
+        get_max_min_projections(shape1->x, shape1->y, shape1->size, unit_axis);
+    vector_t shape2_proj =
+        get_max_min_projections(shape2->x, shape2->y, shape2->size, unit_axis);
 
     if (shape1_proj.y > shape2_proj.x || shape2_proj.y > shape1_proj.x) {
-      list_free(edges1);
-      return (collision_info_t){.collided = false, .axis = VEC_ZERO};
+      return (collision_info_t){.collided = false, .axis = unit_axis};
     }
 
     double overlap = vec_get_length(vec_subtract(shape2_proj, shape1_proj));
@@ -89,27 +191,1150 @@ static collision_info_t compare_collision(list_t *shape1, list_t *shape2,
     }
   }
 
-  list_free(edges1);
   return (collision_info_t){.collided = true, .axis = collision_axis};
 }
 
-collision_info_t find_collision(body_t *body1, body_t *body2) {
-  list_t *shape1 = body_get_shape(body1);
-  list_t *shape2 = body_get_shape(body2);
+/**
+ * Computes the edge normals of a shape and the shape's projections onto them,
+ * so the shape can be tested against many others without redoing this work.
+ *
+ * @param shape the shape
+ * @param normals filled with the unit normal of each edge
+ * @param projections filled with the shape's (max, min) projection onto each
+ *   normal
+ */
+static void project_onto_edges(const collision_shape_t *shape,
+                               vector_t *normals, vector_t *projections) {
+  for (size_t i = 0; i < shape->size; i++) {
+    normals[i] = get_shape_normal(shape, i);
+    projections[i] =
+        get_max_min_projections(shape->x, shape->y, shape->size, normals[i]);
+  }
+}
+
+/**
+ * Same as compare_collision(), but reads the first shape's edge normals and
+ * projections from project_onto_edges() instead of computing them.
+ *
+ * @param normals1 the unit edge normals of the first shape
+ * @param projections1 the first shape's projections onto its edge normals
+ * @param size1 the number of vertices in the first shape
+ * @param shape2 the second shape
+ * @param min_overlap the smallest overlap found so far; updated in place
+ * @return whether the shapes are colliding
+ */
+static collision_info_t
+compare_projected_collision(const vector_t *normals1,
+                            const vector_t *projections1, size_t size1,
+                            const collision_shape_t *shape2,
+                            double *min_overlap) {
+  vector_t collision_axis = VEC_ZERO;
+
+  for (size_t i = 0; i < size1; i++) {
+    vector_t shape1_proj = projections1[i];
+    vector_t shape2_proj = get_max_min_projections(shape2->x, shape2->y,
+                                                   shape2->size, normals1[i]);
+
+    if (shape1_proj.y > shape2_proj.x || shape2_proj.y > shape1_proj.x) {
+      return (collision_info_t){.collided = false, .axis = normals1[i]};
+    }
+
+    double overlap = vec_get_length(vec_subtract(shape2_proj, shape1_proj));
+    if (overlap < *min_overlap) {
+      collision_axis = normals1[i];
+      *min_overlap = overlap;
+    }
+  }
+
+  return (collision_info_t){.collided = true, .axis = collision_axis};
+}
+
+/**
+ * Splits an array of vertices into separate x and y coordinate arrays.
+ *
+ * @param vertices the vertices
+ * @param size the number of vertices
+ * @param x the array to fill with the x-coordinates of the vertices
+ * @param y the array to fill with the y-coordinates of the vertices
+ */
+static void split_coordinates(const vector_t *vertices, size_t size,
+                              double *x, double *y) {
+  for (size_t i = 0; i < size; i++) {
+    x[i] = vertices[i].x;
+    y[i] = vertices[i].y;
+  }
+}
+
+/**
+ * Tests two shapes with the separating axis test on their edge normals,
+ * regardless of their kinds.
+ *
+ * @param shape1 the first shape
+ * @param shape2 the second shape
+ * @return whether the shapes are colliding, and if so, the collision axis
+ */
+static collision_info_t polygon_polygon_collision(
+    const collision_shape_t *shape1, const collision_shape_t *shape2) {
+  assert(shape1->size >= 3 && shape2->size >= 3);
 
   double c1_overlap = __DBL_MAX__;
   double c2_overlap = __DBL_MAX__;
 
   collision_info_t collision1 = compare_collision(shape1, shape2, &c1_overlap);
+  if (!collision1.collided) {
+    return collision1;
+  }
+
   collision_info_t collision2 = compare_collision(shape2, shape1, &c2_overlap);
+  if (!collision2.collided) {
+    return collision2;
+  }
+
+  if (c1_overlap < c2_overlap) {
+    return collision1;
+  }
+  return collision2;
+}
+
+collision_info_t find_polygon_collision(const vector_t *shape1, size_t size1,
+                                        const vector_t *shape2, size_t size2) {
+  double x1[size1];
+  double y1[size1];
+  double x2[size2];
+  double y2[size2];
+  split_coordinates(shape1, size1, x1, y1);
+  split_coordinates(shape2, size2, x2, y2);
+
+  // the polygon test only reads the vertices, so skip classifying the shapes
+  collision_shape_t view1 = {.kind = SHAPE_POLYGON,
+                             .vertices = shape1,
+                             .x = x1,
+                             .y = y1,
+                             .size = size1};
+  collision_shape_t view2 = {.kind = SHAPE_POLYGON,
+                             .vertices = shape2,
+                             .x = x2,
+                             .y = y2,
+                             .size = size2};
+  return polygon_polygon_collision(&view1, &view2);
+}
+
+/**
+ * Returns the collision axis contributed by an axis-aligned edge of a box,
+ * and the overlap the general polygon test would report along it.
+ *
+ * @param edge the edge, from one vertex to the next
+ * @param x_overlap the overlap measure of the two boxes along the x-axis
+ * @param y_overlap the overlap measure of the two boxes along the y-axis
+ * @param overlap set to the overlap measure along the returned axis
+ * @return the unit normal of the edge
+ */
+static vector_t get_box_edge_axis(vector_t edge, double x_overlap,
+                                  double y_overlap, double *overlap) {
+  if (edge.y == 0) {
+    *overlap = y_overlap;
+    return (vector_t){.x = 0, .y = edge.x > 0 ? 1 : -1};
+  }
+  *overlap = x_overlap;
+  return (vector_t){.x = edge.y > 0 ? -1 : 1, .y = 0};
+}
+
+/**
+ * Finds the axis with the smallest overlap among the edge normals of a box.
+ * Edges are visited in vertex order, matching compare_collision().
+ *
+ * @param shape the box whose edge normals to test
+ * @param x_overlap the overlap measure of the two boxes along the x-axis
+ * @param y_overlap the overlap measure of the two boxes along the y-axis
+ * @param min_overlap the smallest overlap found; updated in place
+ * @return the axis with the smallest overlap
+ */
+static vector_t get_box_collision_axis(const collision_shape_t *shape,
+                                       double x_overlap, double y_overlap,
+                                       double *min_overlap) {
+  vector_t collision_axis = VEC_ZERO;
+  for (size_t i = 0; i < shape->size; i++) {
+    vector_t edge = vec_subtract(shape->vertices[i],
+                                 shape->vertices[(i + 1) % shape->size]);
+    double overlap;
+    vector_t axis = get_box_edge_axis(edge, x_overlap, y_overlap, &overlap);
+    if (overlap < *min_overlap) {
+      collision_axis = axis;
+      *min_overlap = overlap;
+    }
+  }
+  return collision_axis;
+}
+
+/**
+ * Tests two axis-aligned boxes for collision using only their bounds.
+ * Reports the same axis as the general polygon test would.
+ *
+ * @param shape1 the first box
+ * @param shape2 the second box
+ * @return whether the boxes are colliding, and if so, the collision axis
+ */
+static collision_info_t aabb_aabb_collision(const collision_shape_t *shape1,
+                                            const collision_shape_t *shape2) {
+  if (shape1->min.x > shape2->max.x || shape2->min.x > shape1->max.x) {
+    return (collision_info_t){.collided = false, .axis = {.x = 1, .y = 0}};
+  }
+  if (shape1->min.y > shape2->max.y || shape2->min.y > shape1->max.y) {
+    return (collision_info_t){.collided = false, .axis = {.x = 0, .y = 1}};
+  }
+
+  double x_overlap = vec_get_length((vector_t){
+      .x = shape2->max.x - shape1->max.x, .y = shape2->min.x - shape1->min.x});
+  double y_overlap = vec_get_length((vector_t){
+      .x = shape2->max.y - shape1->max.y, .y = shape2->min.y - shape1->min.y});
+
+  double c1_overlap = __DBL_MAX__;
+  double c2_overlap = __DBL_MAX__;
+  vector_t axis1 =
+      get_box_collision_axis(shape1, x_overlap, y_overlap, &c1_overlap);
+  vector_t axis2 =
+      get_box_collision_axis(shape2, x_overlap, y_overlap, &c2_overlap);
+
+  return (collision_info_t){.collided = true,
+                            .axis = c1_overlap < c2_overlap ? axis1 : axis2};
+}
+
+/**
+ * Returns the center of a shape's bounding box.
+ *
+ * @param shape the shape
+ * @return the center of the shape's bounds
+ */
+static vector_t get_center(const collision_shape_t *shape) {
+  return vec_multiply(0.5, vec_add(shape->min, shape->max));
+}
+
+/**
+ * Returns half the width and height of a shape's bounding box.
+ * For an ellipse, these are its radii along the x- and y-axes.
+ *
+ * @param shape the shape
+ * @return the half extents of the shape's bounds
+ */
+static vector_t get_half_extents(const collision_shape_t *shape) {
+  return vec_multiply(0.5, vec_subtract(shape->max, shape->min));
+}
+
+/**
+ * Returns the unit vector in the direction of a nonzero vector.
+ *
+ * @param v the vector to normalize
+ * @return v divided by its length
+ */
+static vector_t get_unit(vector_t v) {
+  return vec_multiply(1 / vec_get_length(v), v);
+}
+
+/**
+ * Tests an axis-aligned ellipse against an axis-aligned box in closed form.
+ * Space is scaled so the ellipse becomes the unit circle, which keeps the box
+ * axis-aligned, and the box's closest point to the center is compared with
+ * the radius.
+ *
+ * @param ellipse the ellipse
+ * @param box the box
+ * @return whether the shapes are colliding, and if so, the collision axis
+ * pointing from the ellipse towards the box
+ */
+static collision_info_t ellipse_aabb_collision(const collision_shape_t *ellipse,
+                                               const collision_shape_t *box) {
+  vector_t center = get_center(ellipse);
+  vector_t radius = get_half_extents(ellipse);
+  vector_t closest = {.x = fmax(box->min.x, fmin(center.x, box->max.x)),
+                      .y = fmax(box->min.y, fmin(center.y, box->max.y))};
+  vector_t offset = {.x = (closest.x - center.x) / radius.x,
+                     .y = (closest.y - center.y) / radius.y};
+
+  double dist_sq = vec_dot(offset, offset);
+  if (dist_sq > 0) {
+    // the ellipse's normal at the closest point, mapped back out of unit
+    // space; when the shapes are apart, this also separates them
+    vector_t normal = {.x = offset.x / radius.x, .y = offset.y / radius.y};
+    return (collision_info_t){.collided = dist_sq <= 1,
+                              .axis = get_unit(normal)};
+  }
+
+  // the center is inside the box, so push out through the nearest face
+  double left = center.x - box->min.x;
+  double right = box->max.x - center.x;
+  double bottom = center.y - box->min.y;
+  double top = box->max.y - center.y;
+  double min_depth = left;
+  vector_t axis = {.x = 1, .y = 0};
+  if (right < min_depth) {
+    min_depth = right;
+    axis = (vector_t){.x = -1, .y = 0};
+  }
+  if (bottom < min_depth) {
+    min_depth = bottom;
+    axis = (vector_t){.x = 0, .y = 1};
+  }
+  if (top < min_depth) {
+    axis = (vector_t){.x = 0, .y = -1};
+  }
+  return (collision_info_t){.collided = true, .axis = axis};
+}
+
+/**
+ * Tests an axis-aligned box against an axis-aligned ellipse in closed form.
+ *
+ * @param box the box
+ * @param ellipse the ellipse
+ * @return whether the shapes are colliding, and if so, the collision axis
+ * pointing from the box towards the ellipse
+ */
+static collision_info_t
+aabb_ellipse_collision(const collision_shape_t *box,
+                       const collision_shape_t *ellipse) {
+  collision_info_t info = ellipse_aabb_collision(ellipse, box);
+  info.axis = vec_negate(info.axis);
+  return info;
+}
+
+/**
+ * Tests two axis-aligned ellipses in closed form.
+ * Ellipses with the same aspect ratio, including any two circles, become
+ * circles after scaling the y-axis and are compared by center distance.
+ * Other pairs fall back to the general polygon test.
+ *
+ * @param shape1 the first ellipse
+ * @param shape2 the second ellipse
+ * @return whether the shapes are colliding, and if so, the collision axis
+ */
+static collision_info_t ellipse_ellipse_collision(
+    const collision_shape_t *shape1, const collision_shape_t *shape2) {
+  vector_t radius1 = get_half_extents(shape1);
+  vector_t radius2 = get_half_extents(shape2);
+  double aspect1 = radius1.x * radius2.y;
+  double aspect2 = radius2.x * radius1.y;
+  if (fabs(aspect1 - aspect2) > ELLIPSE_TOLERANCE * aspect1) {
+    return polygon_polygon_collision(shape1, shape2);
+  }
+
+  double scale = radius1.x / radius1.y;
+  vector_t displacement = vec_subtract(get_center(shape2), get_center(shape1));
+  vector_t scaled = {.x = displacement.x, .y = displacement.y * scale};
+  double reach = radius1.x + radius2.x;
+  double dist_sq = vec_dot(scaled, scaled);
+  if (dist_sq == 0) {
+    return (collision_info_t){.collided = true, .axis = {.x = 0, .y = 1}};
+  }
+  // the line between the centers in circle space, mapped back out of it
+  vector_t normal = {.x = scaled.x, .y = scaled.y * scale};
+  return (collision_info_t){.collided = dist_sq <= reach * reach,
+                            .axis = get_unit(normal)};
+}
+
+/**
+ * A collision test specialized for a pair of shape kinds.
+ */
+typedef collision_info_t (*collision_test_t)(const collision_shape_t *shape1,
+                                             const collision_shape_t *shape2);
+
+/**
+ * The collision test for each pair of shape kinds,
+ * indexed by the kind of the first shape and then the second.
+ */
+static const collision_test_t COLLISION_TESTS[SHAPE_KIND_COUNT]
+                                             [SHAPE_KIND_COUNT] = {
+    [SHAPE_POLYGON] = {[SHAPE_POLYGON] = polygon_polygon_collision,
+                       [SHAPE_AABB] = polygon_polygon_collision,
+                       [SHAPE_ELLIPSE] = polygon_polygon_collision},
+    [SHAPE_AABB] = {[SHAPE_POLYGON] = polygon_polygon_collision,
+                    [SHAPE_AABB] = aabb_aabb_collision,
+                    [SHAPE_ELLIPSE] = aabb_ellipse_collision},
+    [SHAPE_ELLIPSE] = {[SHAPE_POLYGON] = polygon_polygon_collision,
+                       [SHAPE_AABB] = ellipse_aabb_collision,
+                       [SHAPE_ELLIPSE] = ellipse_ellipse_collision}};
+
+/**
+ * Gets a view of a body's current shape, borrowing its vertices, kind and
+ * bounds from the body's shape cache rather than copying or recomputing
+ * them.
+ *
+ * @param body the body
+ * @return a view of the body's shape, valid until the body next moves
+ */
+static collision_shape_t get_body_shape(body_t *body) {
+  shape_view_t shape = shape_view_get(body);
+  collision_shape_t view = {.kind = shape.kind,
+                            .vertices = shape.vertices,
+                            .x = shape.x,
+                            .y = shape.y,
+                            .normals = NULL,
+                            .size = shape.size,
+                            .min = shape.min,
+                            .max = shape.max};
+  // ellipses are tested exactly, without their tessellation's edges
+  if (view.kind != SHAPE_ELLIPSE) {
+    view.normals = shape_view_get_normals(body);
+  }
+  return view;
+}
+
+collision_info_t find_shape_collision(const collision_shape_t *shape1,
+                                      const collision_shape_t *shape2) {
+  return COLLISION_TESTS[shape1->kind][shape2->kind](shape1, shape2);
+}
+
+/**
+ * Returns the maximum and minimum projections of a shape onto an axis.
+ * Ellipses are projected exactly rather than through their tessellation,
+ * so an axis that separates the projections separates the shapes under
+ * every test find_shape_collision() might pick for them.
+ *
+ * @param shape the shape
+ * @param axis the axis to project onto; need not be a unit vector
+ * @return a vector in the form (max, min)
+ */
+static vector_t get_shape_projections(const collision_shape_t *shape,
+                                      vector_t axis) {
+  if (shape->kind != SHAPE_ELLIPSE) {
+    return get_max_min_projections(shape->x, shape->y, shape->size, axis);
+  }
+  vector_t radius = get_half_extents(shape);
+  double center = vec_dot(axis, get_center(shape));
+  double reach = hypot(radius.x * axis.x, radius.y * axis.y);
+  return (vector_t){.x = center + reach, .y = center - reach};
+}
+
+/**
+ * Returns the point of a shape furthest along a direction.
+ * Ellipses give the exact point on the ellipse rather than a vertex of their
+ * tessellation.
+ *
+ * @param shape the shape
+ * @param direction the direction to search along; need not be a unit vector
+ * @return the shape's support point in that direction
+ */
+static vector_t get_support_point(const collision_shape_t *shape,
+                                  vector_t direction) {
+  if (shape->kind == SHAPE_ELLIPSE) {
+    vector_t radius = get_half_extents(shape);
+    vector_t scaled = {.x = radius.x * radius.x * direction.x,
+                       .y = radius.y * radius.y * direction.y};
+    double length = hypot(radius.x * direction.x, radius.y * direction.y);
+    return vec_add(get_center(shape), vec_multiply(1 / length, scaled));
+  }
+  vector_t support = shape->vertices[0];
+  double max = vec_dot(direction, support);
+  for (size_t i = 1; i < shape->size; i++) {
+    double length = vec_dot(direction, shape->vertices[i]);
+    if (length > max) {
+      max = length;
+      support = shape->vertices[i];
+    }
+  }
+  return support;
+}
+
+/**
+ * Finds the edge of a polygon whose outward normal is closest to a direction.
+ *
+ * @param shape the shape, which must not be an ellipse
+ * @param direction the unit direction to compare the edge normals with
+ * @param alignment set to the dot product of that edge's normal and direction
+ * @return the index of the edge, which runs from that vertex to the next
+ */
+static size_t find_aligned_edge(const collision_shape_t *shape,
+                                vector_t direction, double *alignment) {
+  size_t best = 0;
+  *alignment = -__DBL_MAX__;
+  for (size_t i = 0; i < shape->size; i++) {
+    double dot = vec_dot(direction, get_shape_normal(shape, i));
+    if (dot > *alignment) {
+      *alignment = dot;
+      best = i;
+    }
+  }
+  return best;
+}
+
+/**
+ * Finds where the incident shape touches the reference edge, by clipping the
+ * incident shape's edge that faces the reference edge to the reference edge's
+ * extent and keeping the parts that are behind it.
+ *
+ * @param contact the contact, whose reference edge is already set;
+ *   its points are filled in place
+ * @param incident the shape the reference edge does not belong to
+ */
+static void find_contact_points(contact_info_t *contact,
+                                const collision_shape_t *incident) {
+  vector_t normal = contact->reference_normal;
+  if (incident->kind == SHAPE_ELLIPSE) {
+    contact->points[0] = get_support_point(incident, vec_negate(normal));
+    contact->num_points = 1;
+    return;
+  }
+
+  double alignment;
+  size_t i = find_aligned_edge(incident, vec_negate(normal), &alignment);
+  vector_t clipped[2] = {incident->vertices[i],
+                         incident->vertices[(i + 1) % incident->size]};
+  vector_t start = contact->reference_start;
+  vector_t tangent = vec_subtract(contact->reference_end, start);
+  double length_sq = vec_dot(tangent, tangent);
+
+  // clip the incident edge to the slab swept out by the reference edge
+  double t0 = vec_dot(vec_subtract(clipped[0], start), tangent);
+  double t1 = vec_dot(vec_subtract(clipped[1], start), tangent);
+  if (t0 != t1) {
+    vector_t p0 = clipped[0];
+    vector_t p1 = clipped[1];
+    double lo = fmax(0, fmin(t0, t1));
+    double hi = fmin(length_sq, fmax(t0, t1));
+    if (lo <= hi) {
+      clipped[0] = vec_add(p0, vec_multiply((lo - t0) / (t1 - t0),
+                                            vec_subtract(p1, p0)));
+      clipped[1] = vec_add(p0, vec_multiply((hi - t0) / (t1 - t0),
+                                            vec_subtract(p1, p0)));
+    }
+  }
+
+  contact->num_points = 0;
+  for (size_t j = 0; j < 2; j++) {
+    if (vec_dot(vec_subtract(clipped[j], start), normal) <= 0) {
+      contact->points[contact->num_points++] = clipped[j];
+    }
+  }
+  if (contact->num_points == 0) {
+    contact->points[0] = get_support_point(incident, vec_negate(normal));
+    contact->num_points = 1;
+  }
+}
+
+contact_info_t find_shape_contact(const collision_shape_t *shape1,
+                                  const collision_shape_t *shape2) {
+  collision_info_t info = find_shape_collision(shape1, shape2);
+  contact_info_t contact = {.collided = info.collided,
+                            .axis = info.axis,
+                            .depth = 0,
+                            .num_points = 0,
+                            .reference = NO_REFERENCE};
+  if (!info.collided) {
+    return contact;
+  }
+
+  // the tests do not orient their axes, so orient it by the smaller overlap
+  vector_t proj1 = get_shape_projections(shape1, info.axis);
+  vector_t proj2 = get_shape_projections(shape2, info.axis);
+  double forward = proj1.x - proj2.y;
+  double backward = proj2.x - proj1.y;
+  if (backward < forward) {
+    contact.axis = vec_negate(info.axis);
+  }
+  contact.depth = fmax(0, fmin(forward, backward));
+
+  double alignment1 = -__DBL_MAX__;
+  double alignment2 = -__DBL_MAX__;
+  size_t edge1 = 0;
+  size_t edge2 = 0;
+  if (shape1->kind != SHAPE_ELLIPSE) {
+    edge1 = find_aligned_edge(shape1, contact.axis, &alignment1);
+  }
+  if (shape2->kind != SHAPE_ELLIPSE) {
+    edge2 = find_aligned_edge(shape2, vec_negate(contact.axis), &alignment2);
+  }
+
+  if (shape1->kind == SHAPE_ELLIPSE && shape2->kind == SHAPE_ELLIPSE) {
+    vector_t support1 = get_support_point(shape1, contact.axis);
+    vector_t support2 = get_support_point(shape2, vec_negate(contact.axis));
+    contact.points[0] = vec_multiply(0.5, vec_add(support1, support2));
+    contact.num_points = 1;
+    return contact;
+  }
+
+  const collision_shape_t *reference = shape1;
+  const collision_shape_t *incident = shape2;
+  size_t edge = edge1;
+  contact.reference = REFERENCE_SHAPE1;
+  if (alignment2 > alignment1) {
+    reference = shape2;
+    incident = shape1;
+    edge = edge2;
+    contact.reference = REFERENCE_SHAPE2;
+  }
+  contact.reference_start = reference->vertices[edge];
+  contact.reference_end = reference->vertices[(edge + 1) % reference->size];
+  contact.reference_normal = get_shape_normal(reference, edge);
+  find_contact_points(&contact, incident);
+  return contact;
+}
+
+/**
+ * Returns the point of a shape furthest along a direction, by walking from a
+ * starting vertex to whichever neighbor is further along until neither is.
+ * A convex polygon has no other local maximum, so this finds the same support
+ * point as a full scan while usually visiting only a few vertices.
+ * Ellipses use their exact support point.
+ *
+ * @param shape the shape
+ * @param direction the direction to search along; need not be a unit vector
+ * @param start the vertex to start from; set to the support vertex, so that
+ *   the next search in a nearby direction starts close to its answer
+ * @return the shape's support point in that direction
+ */
+static vector_t climb_support_point(const collision_shape_t *shape,
+                                    vector_t direction, size_t *start) {
+  if (shape->kind == SHAPE_ELLIPSE) {
+    return get_support_point(shape, direction);
+  }
+  size_t i = *start;
+  double max = vec_dot(direction, shape->vertices[i]);
+  while (true) {
+    size_t next = (i + 1) % shape->size;
+    size_t prev = (i + shape->size - 1) % shape->size;
+    double next_length = vec_dot(direction, shape->vertices[next]);
+    double prev_length = vec_dot(direction, shape->vertices[prev]);
+    if (next_length > max) {
+      i = next;
+      max = next_length;
+    } else if (prev_length > max) {
+      i = prev;
+      max = prev_length;
+    } else {
+      break;
+    }
+  }
+  *start = i;
+  return shape->vertices[i];
+}
+
+/**
+ * The state GJK and EPA share while searching the Minkowski difference
+ * shape1 - shape2 of a pair of shapes.
+ */
+typedef struct {
+  const collision_shape_t *shape1;
+  const collision_shape_t *shape2;
+  /** Where each shape's last support search ended */
+  size_t start1;
+  size_t start2;
+} minkowski_t;
+
+/**
+ * Returns the point of the Minkowski difference furthest along a direction.
+ */
+static vector_t get_minkowski_support(minkowski_t *minkowski,
+                                      vector_t direction) {
+  vector_t support1 =
+      climb_support_point(minkowski->shape1, direction, &minkowski->start1);
+  vector_t support2 = climb_support_point(
+      minkowski->shape2, vec_negate(direction), &minkowski->start2);
+  return vec_subtract(support1, support2);
+}
+
+/**
+ * Returns a normal of a line that points towards a point.
+ *
+ * @param line the direction of the line
+ * @param towards a vector from a point on the line towards the point
+ * @return a normal of the line, not normalized, on the same side as the point
+ */
+static vector_t get_normal_towards(vector_t line, vector_t towards) {
+  vector_t normal = {.x = -line.y, .y = line.x};
+  return vec_dot(normal, towards) < 0 ? vec_negate(normal) : normal;
+}
+
+/**
+ * Reduces a GJK simplex to the feature closest to the origin, and picks the
+ * next direction to search in.
+ * The newest point is last.
+ *
+ * @param simplex the simplex's points; updated in place
+ * @param size the number of points in the simplex, 2 or 3; updated in place
+ * @param direction set to the next search direction
+ * @return whether the simplex is a triangle that contains the origin
+ */
+static bool update_simplex(vector_t *simplex, size_t *size,
+                           vector_t *direction) {
+  vector_t a = simplex[*size - 1];
+  vector_t to_origin = vec_negate(a);
+  if (*size == 2) {
+    vector_t ab = vec_subtract(simplex[0], a);
+    if (vec_dot(ab, to_origin) > 0) {
+      *direction = get_normal_towards(ab, to_origin);
+    } else {
+      simplex[0] = a;
+      *size = 1;
+      *direction = to_origin;
+    }
+    return false;
+  }
+
+  vector_t ab = vec_subtract(simplex[1], a);
+  vector_t ac = vec_subtract(simplex[0], a);
+  vector_t ab_normal = get_normal_towards(ab, vec_negate(ac));
+  vector_t ac_normal = get_normal_towards(ac, vec_negate(ab));
+  if (vec_dot(ab_normal, to_origin) > 0) {
+    simplex[0] = simplex[1];
+    simplex[1] = a;
+    *size = 2;
+    *direction = ab_normal;
+    return false;
+  }
+  if (vec_dot(ac_normal, to_origin) > 0) {
+    simplex[1] = a;
+    *size = 2;
+    *direction = ac_normal;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Expands a triangle inside the Minkowski difference that contains the origin
+ * until its edge closest to the origin lies on the difference's boundary.
+ * That edge's normal is the direction in which the shapes overlap least.
+ *
+ * @param minkowski the pair of shapes
+ * @param triangle a triangle of support points containing the origin
+ * @param depth set to how far the shapes overlap along the returned axis
+ * @return the unit axis of least overlap, pointing from shape1 towards shape2
+ */
+static vector_t expand_polytope(minkowski_t *minkowski,
+                                const vector_t *triangle, double *depth) {
+  vector_t polytope[EPA_MAX_VERTICES];
+  size_t size = 3;
+  polytope[0] = triangle[0];
+  polytope[1] = triangle[1];
+  polytope[2] = triangle[2];
+  // get_edge_normal() gives outward normals only in counterclockwise order
+  vector_t ab = vec_subtract(polytope[1], polytope[0]);
+  vector_t ac = vec_subtract(polytope[2], polytope[0]);
+  if (vec_cross(ab, ac) < 0) {
+    polytope[1] = triangle[2];
+    polytope[2] = triangle[1];
+  }
+
+  while (true) {
+    size_t closest = 0;
+    vector_t normal = VEC_ZERO;
+    double distance = __DBL_MAX__;
+    for (size_t i = 0; i < size; i++) {
+      vector_t edge_normal = get_edge_normal(polytope, size, i);
+      double edge_distance = vec_dot(edge_normal, polytope[i]);
+      if (edge_distance < distance) {
+        closest = i;
+        normal = edge_normal;
+        distance = edge_distance;
+      }
+    }
+
+    vector_t support = get_minkowski_support(minkowski, normal);
+    if (vec_dot(support, normal) - distance < EPA_TOLERANCE ||
+        size == EPA_MAX_VERTICES) {
+      *depth = distance;
+      // the difference is shape1 - shape2, so its boundary faces shape2
+      return normal;
+    }
+    for (size_t i = size; i > closest + 1; i--) {
+      polytope[i] = polytope[i - 1];
+    }
+    polytope[closest + 1] = support;
+    size++;
+  }
+}
+
+collision_info_t find_gjk_collision(const collision_shape_t *shape1,
+                                    const collision_shape_t *shape2,
+                                    double *depth) {
+  minkowski_t minkowski = {
+      .shape1 = shape1, .shape2 = shape2, .start1 = 0, .start2 = 0};
+  vector_t direction = vec_subtract(get_center(shape1), get_center(shape2));
+  if (direction.x == 0 && direction.y == 0) {
+    direction = (vector_t){.x = 1, .y = 0};
+  }
+
+  vector_t simplex[3];
+  size_t size = 0;
+  for (size_t i = 0; i < GJK_MAX_ITERATIONS; i++) {
+    vector_t support = get_minkowski_support(&minkowski, direction);
+    if (vec_dot(support, direction) < 0) {
+      // nothing in the difference reaches the origin along this direction
+      return (collision_info_t){.collided = false,
+                                .axis = get_unit(direction)};
+    }
+    simplex[size++] = support;
+    if (size == 1) {
+      direction = vec_negate(support);
+    } else if (update_simplex(simplex, &size, &direction)) {
+      if (vec_cross(vec_subtract(simplex[1], simplex[0]),
+                    vec_subtract(simplex[2], simplex[0])) == 0) {
+        // a flat triangle has no edge normals for EPA to expand along
+        break;
+      }
+      double overlap;
+      vector_t axis = expand_polytope(&minkowski, simplex, &overlap);
+      if (depth != NULL) {
+        *depth = overlap;
+      }
+      return (collision_info_t){.collided = true, .axis = axis};
+    }
+    if (direction.x == 0 && direction.y == 0) {
+      // the origin is on the simplex, so the shapes are exactly touching
+      break;
+    }
+  }
+
+  // touching shapes can leave GJK without a proper triangle around the origin
+  contact_info_t contact = find_shape_contact(shape1, shape2);
+  if (depth != NULL) {
+    *depth = contact.depth;
+  }
+  return (collision_info_t){.collided = contact.collided,
+                            .axis = contact.axis};
+}
+
+collision_info_t find_shape_collision_using(const collision_shape_t *shape1,
+                                            const collision_shape_t *shape2,
+                                            narrow_phase_t narrow_phase) {
+  if (narrow_phase == NARROW_PHASE_GJK) {
+    return find_gjk_collision(shape1, shape2, NULL);
+  }
+  return find_shape_collision(shape1, shape2);
+}
+
+bool can_collide(collision_filter_t filter1, collision_filter_t filter2) {
+  return (filter1.layer & filter2.mask) && (filter2.layer & filter1.mask);
+}
+
+void find_bounding_box(body_t *body, vector_t *min, vector_t *max) {
+  shape_view_get_bounds(body, min, max);
+}
+
+/**
+ * Finds the range of times during which a moving interval overlaps a
+ * stationary one along one axis.
+ *
+ * @param min1 the moving interval's lower bound at the start
+ * @param max1 the moving interval's upper bound at the start
+ * @param displacement how far the moving interval travels
+ * @param min2 the stationary interval's lower bound
+ * @param max2 the stationary interval's upper bound
+ * @param enter set to when the intervals start overlapping
+ * @param exit set to when the intervals stop overlapping
+ * @return whether the intervals overlap at any time
+ */
+static bool sweep_axis(double min1, double max1, double displacement,
+                       double min2, double max2, double *enter,
+                       double *exit) {
+  if (displacement == 0) {
+    // intervals that only share an endpoint are sliding past each other
+    if (min1 < max2 && min2 < max1) {
+      *enter = -INFINITY;
+      *exit = INFINITY;
+      return true;
+    }
+    return false;
+  }
+  double t1 = (min2 - max1) / displacement;
+  double t2 = (max2 - min1) / displacement;
+  *enter = fmin(t1, t2);
+  *exit = fmax(t1, t2);
+  return true;
+}
+
+bool find_time_of_impact(vector_t min1, vector_t max1, vector_t displacement,
+                         vector_t min2, vector_t max2, double *time,
+                         vector_t *normal) {
+  double enter_x;
+  double exit_x;
+  double enter_y;
+  double exit_y;
+  if (!sweep_axis(min1.x, max1.x, displacement.x, min2.x, max2.x, &enter_x,
+                  &exit_x) ||
+      !sweep_axis(min1.y, max1.y, displacement.y, min2.y, max2.y, &enter_y,
+                  &exit_y)) {
+    return false;
+  }
+
+  // the boxes overlap once they overlap along both axes
+  double enter = fmax(enter_x, enter_y);
+  double exit = fmin(exit_x, exit_y);
+  if (enter >= exit || enter < 0 || enter > 1) {
+    return false;
+  }
+
+  *time = enter;
+  if (enter_x > enter_y) {
+    *normal = (vector_t){.x = displacement.x > 0 ? -1 : 1, .y = 0};
+  } else {
+    *normal = (vector_t){.x = 0, .y = displacement.y > 0 ? -1 : 1};
+  }
+  return true;
+}
+
+/**
+ * A pair of bodies, their versions (see body_get_version()) when they were
+ * last tested, and the result of that test.
+ */
+typedef struct {
+  body_t *body1;
+  body_t *body2;
+  uint64_t version1;
+  uint64_t version2;
+  collision_info_t info;
+} cache_entry_t;
+
+/**
+ * The cache slots that have held pairs involving a body, so removing the
+ * body only visits those slots.
+ * Slots are added when a pair involving the body is stored, but not taken
+ * out when the pair is evicted, so some may hold other pairs by now; they
+ * are pruned before the list grows.
+ */
+typedef struct {
+  body_t *body;
+  size_t *slots;
+  size_t size;
+  size_t capacity;
+} body_slots_t;
+
+struct collision_cache {
+  /** Direct-mapped by pair; a new pair evicts whatever shared its slot */
+  cache_entry_t *entries;
+  /** The slots of each body with pairs in the cache, kept dense, and a map
+   * from each body to its index in the array */
+  body_slots_t *bodies;
+  size_t num_bodies;
+  size_t bodies_capacity;
+  hash_map_t *index;
+};
 
-  list_free(shape1);
-  list_free(shape2);
+collision_cache_t *collision_cache_init(void) {
+  collision_cache_t *cache = malloc(sizeof(collision_cache_t));
+  assert(cache);
+  cache->entries = calloc(COLLISION_CACHE_SIZE, sizeof(cache_entry_t));
+  cache->bodies = malloc(INIT_CACHE_BODIES_CAPACITY * sizeof(body_slots_t));
+  assert(cache->entries && cache->bodies);
+  cache->num_bodies = 0;
+  cache->bodies_capacity = INIT_CACHE_BODIES_CAPACITY;
+  cache->index = hash_map_init(INIT_CACHE_BODIES_CAPACITY);
+  return cache;
+}
 
+/**
+ * Returns a body's list of slots, adding an empty one if it has none.
+ */
+static body_slots_t *get_body_slots(collision_cache_t *cache, body_t *body) {
+  size_t i = hash_map_get(cache->index, (uintptr_t)body);
+  if (i != HASH_MAP_NONE) {
+    return &cache->bodies[i];
+  }
+  if (cache->num_bodies == cache->bodies_capacity) {
+    cache->bodies_capacity *= 2;
+    cache->bodies = realloc(cache->bodies,
+                            cache->bodies_capacity * sizeof(body_slots_t));
+    assert(cache->bodies);
+  }
+  i = cache->num_bodies++;
+  cache->bodies[i] = (body_slots_t){.body = body};
+  hash_map_put(cache->index, (uintptr_t)body, i);
+  return &cache->bodies[i];
+}
+
+/**
+ * Orders slot numbers, for qsort().
+ */
+static int compare_slots(const void *a, const void *b) {
+  size_t slot1 = *(const size_t *)a;
+  size_t slot2 = *(const size_t *)b;
+  return (slot1 > slot2) - (slot1 < slot2);
+}
+
+/**
+ * Drops the slots in a body's list that no longer hold one of its pairs, and
+ * any duplicates.
+ */
+static void prune_body_slots(collision_cache_t *cache, body_slots_t *record) {
+  if (record->size == 0) {
+    return;
+  }
+  qsort(record->slots, record->size, sizeof(size_t), compare_slots);
+  size_t kept = 0;
+  for (size_t i = 0; i < record->size; i++) {
+    size_t slot = record->slots[i];
+    cache_entry_t *entry = &cache->entries[slot];
+    bool live = entry->body1 == record->body || entry->body2 == record->body;
+    if (live && (kept == 0 || record->slots[kept - 1] != slot)) {
+      record->slots[kept++] = slot;
+    }
+  }
+  record->size = kept;
+}
+
+/**
+ * Records that a cache slot now holds a pair involving a body.
+ */
+static void track_slot(collision_cache_t *cache, body_t *body, size_t slot) {
+  body_slots_t *record = get_body_slots(cache, body);
+  if (record->size == record->capacity) {
+    prune_body_slots(cache, record);
+    // grow only if pruning left the list at least half full, so each slot
+    // is pruned amortized constant times
+    if (2 * record->size >= record->capacity) {
+      record->capacity =
+          record->capacity ? record->capacity * 2 : INIT_BODY_SLOTS_CAPACITY;
+      record->slots =
+          realloc(record->slots, record->capacity * sizeof(size_t));
+      assert(record->slots);
+    }
+  }
+  record->slots[record->size++] = slot;
+}
+
+void collision_cache_remove(collision_cache_t *cache, body_t *body) {
+  size_t i = hash_map_remove(cache->index, (uintptr_t)body);
+  if (i == HASH_MAP_NONE) {
+    return;
+  }
+  body_slots_t *record = &cache->bodies[i];
+  for (size_t j = 0; j < record->size; j++) {
+    cache_entry_t *entry = &cache->entries[record->slots[j]];
+    if (entry->body1 == body || entry->body2 == body) {
+      *entry = (cache_entry_t){.body1 = NULL, .body2 = NULL};
+    }
+  }
+  free(record->slots);
+
+  // keep the bodies dense by moving the last into the freed place
+  size_t last = --cache->num_bodies;
+  if (i != last) {
+    cache->bodies[i] = cache->bodies[last];
+    hash_map_put(cache->index, (uintptr_t)cache->bodies[i].body, i);
+  }
+}
+
+void collision_cache_free(collision_cache_t *cache) {
+  for (size_t i = 0; i < cache->num_bodies; i++) {
+    free(cache->bodies[i].slots);
+  }
+  free(cache->bodies);
+  hash_map_free(cache->index);
+  free(cache->entries);
+  free(cache);
+}
+
+/**
+ * Returns the slot of a collision cache that an ordered pair of bodies uses.
+ */
+static cache_entry_t *get_cache_entry(collision_cache_t *cache, body_t *body1,
+                                      body_t *body2) {
+  size_t key = ((uintptr_t)body1 >> 4) * 2654435761u ^
+               ((uintptr_t)body2 >> 4) * 40503u;
+  return &cache->entries[key & (COLLISION_CACHE_SIZE - 1)];
+}
+
+/**
+ * Stores the result of testing a pair in its cache slot, recording the slot
+ * against both bodies if it held a different pair before.
+ */
+static void store_cache_entry(collision_cache_t *cache, cache_entry_t *entry,
+                              cache_entry_t stored) {
+  if (entry->body1 != stored.body1 || entry->body2 != stored.body2) {
+    size_t slot = entry - cache->entries;
+    track_slot(cache, stored.body1, slot);
+    track_slot(cache, stored.body2, slot);
+  }
+  *entry = stored;
+}
+
+/**
+ * Returns whether two shapes' projections onto an axis are disjoint.
+ * The zero vector never separates anything.
+ */
+static bool is_separating_axis(const collision_shape_t *shape1,
+                               const collision_shape_t *shape2,
+                               vector_t axis) {
+  vector_t proj1 = get_shape_projections(shape1, axis);
+  vector_t proj2 = get_shape_projections(shape2, axis);
+  return proj1.y > proj2.x || proj2.y > proj1.x;
+}
+
+collision_info_t find_collision_cached(collision_cache_t *cache,
+                                       body_t *body1, body_t *body2) {
+  uint64_t version1 = body_get_version(body1);
+  uint64_t version2 = body_get_version(body2);
+  cache_entry_t *entry = NULL;
+  bool hit = false;
+  if (cache != NULL) {
+    entry = get_cache_entry(cache, body1, body2);
+    hit = entry->body1 == body1 && entry->body2 == body2;
+    if (hit && entry->version1 == version1 && entry->version2 == version2) {
+      // neither body has moved, so neither has its shape
+      return entry->info;
+    }
+  }
+
+  collision_shape_t view1 = get_body_shape(body1);
+  collision_shape_t view2 = get_body_shape(body2);
+
+  collision_info_t info;
+  if (hit && !entry->info.collided &&
+      is_separating_axis(&view1, &view2, entry->info.axis)) {
+    info = entry->info;
+  } else {
+    info = find_shape_collision(&view1, &view2);
+  }
+
+  if (entry != NULL) {
+    store_cache_entry(cache, entry,
+                      (cache_entry_t){.body1 = body1,
+                                      .body2 = body2,
+                                      .version1 = version1,
+                                      .version2 = version2,
+                                      .info = info});
+  }
+  return info;
+}
+
+collision_info_t find_collision(body_t *body1, body_t *body2) {
+  return find_collision_cached(NULL, body1, body2);
+}
+
+collision_info_t find_collision_using(body_t *body1, body_t *body2,
+                                      narrow_phase_t narrow_phase) {
+  collision_shape_t view1 = get_body_shape(body1);
+  collision_shape_t view2 = get_body_shape(body2);
+  return find_shape_collision_using(&view1, &view2, narrow_phase);
+}
+
+/**
+ * Tests a shape whose edge normals and projections onto them have already
+ * been computed by project_onto_edges() against another shape.
+ * Gives the same result as find_shape_collision().
+ *
+ * @param shape the first shape
+ * @param normals the unit edge normals of the first shape
+ * @param projections the first shape's projections onto its edge normals
+ * @param other the second shape
+ * @return whether the shapes are colliding, and if so, the collision axis
+ */
+static collision_info_t
+find_projected_collision(const collision_shape_t *shape,
+                         const vector_t *normals, const vector_t *projections,
+                         const collision_shape_t *other) {
+  if (COLLISION_TESTS[shape->kind][other->kind] != polygon_polygon_collision) {
+    return find_shape_collision(shape, other);
+  }
+
+  double c1_overlap = __DBL_MAX__;
+  double c2_overlap = __DBL_MAX__;
+  collision_info_t collision1 =
+      compare_projected_collision(normals, projections, shape->size, other,
+                                  &c1_overlap);
   if (!collision1.collided) {
     return collision1;
   }
 
+  collision_info_t collision2 = compare_collision(other, shape, &c2_overlap);
   if (!collision2.collided) {
     return collision2;
   }
@@ -119,3 +1344,58 @@ collision_info_t find_collision(body_t *body1, body_t *body2) {
   }
   return collision2;
 }
+
+size_t find_collisions(collision_cache_t *cache, body_t *body,
+                       body_t **candidates, size_t count,
+                       collision_hit_t *hits) {
+  collision_shape_t view = get_body_shape(body);
+  vector_t normals[view.size];
+  vector_t projections[view.size];
+  project_onto_edges(&view, normals, projections);
+  uint64_t version = body_get_version(body);
+
+  size_t num_hits = 0;
+  for (size_t i = 0; i < count; i++) {
+    uint64_t other_version = body_get_version(candidates[i]);
+    cache_entry_t *entry = NULL;
+    bool hit = false;
+    if (cache != NULL) {
+      entry = get_cache_entry(cache, body, candidates[i]);
+      hit = entry->body1 == body && entry->body2 == candidates[i];
+    }
+
+    collision_info_t info;
+    if (hit && entry->version1 == version &&
+        entry->version2 == other_version) {
+      info = entry->info;
+    } else {
+      collision_shape_t other = get_body_shape(candidates[i]);
+
+      if (hit && !entry->info.collided &&
+          is_separating_axis(&view, &other, entry->info.axis)) {
+        info = entry->info;
+      } else {
+        info = find_projected_collision(&view, normals, projections, &other);
+      }
+      if (entry != NULL) {
+        store_cache_entry(cache, entry,
+                          (cache_entry_t){.body1 = body,
+                                          .body2 = candidates[i],
+                                          .version1 = version,
+                                          .version2 = other_version,
+                                          .info = info});
+      }
+    }
+
+    if (info.collided) {
+      hits[num_hits++] = (collision_hit_t){.index = i, .axis = info.axis};
+    }
+  }
+  return num_hits;
+}
+
+contact_info_t find_contact(body_t *body1, body_t *body2) {
+  collision_shape_t view1 = get_body_shape(body1);
+  collision_shape_t view2 = get_body_shape(body2);
+  return find_shape_contact(&view1, &view2);
+}
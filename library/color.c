@@ -0,0 +1,13 @@
+#include "color.h"
+
+#include <stdlib.h>
+
+color_t color_get_random() {
+  return (color_t){.red = (double)rand() / RAND_MAX,
+                   .green = (double)rand() / RAND_MAX,
+                   .blue = (double)rand() / RAND_MAX};
+}
+
+bool color_is_equal(color_t c1, color_t c2) {
+  return c1.red == c2.red && c1.green == c2.green && c1.blue == c2.blue;
+}
@@ -0,0 +1,191 @@
+#include "contact_table.h"
+#include "hash_map.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/** Initial capacity of the contact and event arrays, and of the pair index */
+static const size_t INIT_CONTACTS_CAPACITY = 8;
+
+/**
+ * A pair in contact as of its last report.
+ */
+typedef struct {
+  body_handle_t body1;
+  body_handle_t body2;
+  vector_t axis;
+  /** The step the pair was last reported in */
+  size_t step;
+  /** Whether the pair was first reported in its last step */
+  bool is_new;
+} contact_t;
+
+/**
+ * The contacts are kept dense, so an update visits only the pairs in
+ * contact; removing one moves the last into its place.
+ */
+struct contact_table {
+  contact_t *contacts;
+  size_t size;
+  size_t capacity;
+
+  /** Map from pair to contact; see pair_key() */
+  hash_map_t *index;
+
+  contact_event_t *events;
+  size_t events_capacity;
+  size_t step;
+};
+
+contact_table_t *contact_table_init(void) {
+  contact_table_t *table = malloc(sizeof(contact_table_t));
+  assert(table);
+  table->contacts = malloc(INIT_CONTACTS_CAPACITY * sizeof(contact_t));
+  table->index = hash_map_init(INIT_CONTACTS_CAPACITY);
+  table->events = malloc(INIT_CONTACTS_CAPACITY * sizeof(contact_event_t));
+  assert(table->contacts && table->events);
+  table->size = 0;
+  table->capacity = INIT_CONTACTS_CAPACITY;
+  table->events_capacity = INIT_CONTACTS_CAPACITY;
+  table->step = 0;
+  return table;
+}
+
+/**
+ * Returns whether two handles are the same.
+ */
+static bool same_handle(body_handle_t handle1, body_handle_t handle2) {
+  return handle1.index == handle2.index &&
+         handle1.generation == handle2.generation;
+}
+
+/**
+ * Returns the key a pair is indexed by: the pool slots of its handles.
+ * A pair of live bodies is the only pair with current handles to those
+ * slots, so a contact found under its key whose handles are out of date was
+ * left by a revoked body; it stays unindexed until its contact ends.
+ */
+static uint64_t pair_key(body_handle_t body1, body_handle_t body2) {
+  return (uint64_t)body1.index << 32 | body2.index;
+}
+
+contact_event_type_t contact_table_report(contact_table_t *table,
+                                          body_t *body1, body_t *body2,
+                                          vector_t axis) {
+  body_handle_t handle1 = body_handle_issue(body1);
+  body_handle_t handle2 = body_handle_issue(body2);
+  uint64_t key = pair_key(handle1, handle2);
+  size_t i = hash_map_get(table->index, key);
+  if (i != HASH_MAP_NONE) {
+    contact_t *contact = &table->contacts[i];
+    if (same_handle(contact->body1, handle1) &&
+        same_handle(contact->body2, handle2)) {
+      contact->axis = axis;
+      if (contact->step != table->step) {
+        contact->step = table->step;
+        contact->is_new = false;
+      }
+      return contact->is_new ? CONTACT_BEGIN : CONTACT_PERSIST;
+    }
+  }
+
+  if (table->size == table->capacity) {
+    table->capacity *= 2;
+    table->contacts =
+        realloc(table->contacts, table->capacity * sizeof(contact_t));
+    assert(table->contacts);
+  }
+  table->contacts[table->size] = (contact_t){.body1 = handle1,
+                                             .body2 = handle2,
+                                             .axis = axis,
+                                             .step = table->step,
+                                             .is_new = true};
+  hash_map_put(table->index, key, table->size++);
+  return CONTACT_BEGIN;
+}
+
+/**
+ * Returns whether a contact's bodies are resting: both still resolve, at
+ * least one is asleep, and the other is asleep or static. Resting bodies are
+ * not tested (see scene_set_sleeping()), and cannot have separated.
+ */
+static bool is_resting(contact_t *contact) {
+  body_t *body1 = body_handle_resolve(contact->body1);
+  body_t *body2 = body_handle_resolve(contact->body2);
+  if (body1 == NULL || body2 == NULL) {
+    return false;
+  }
+  bool still1 = body_is_sleeping(body1) || body_get_kind(body1) == BODY_STATIC;
+  bool still2 = body_is_sleeping(body2) || body_get_kind(body2) == BODY_STATIC;
+  return still1 && still2 &&
+         (body_is_sleeping(body1) || body_is_sleeping(body2));
+}
+
+/**
+ * Removes the contact at an index, moving the last contact into its place.
+ */
+static void remove_contact(contact_table_t *table, size_t i) {
+  contact_t *contact = &table->contacts[i];
+  uint64_t key = pair_key(contact->body1, contact->body2);
+  if (hash_map_get(table->index, key) == i) {
+    hash_map_remove(table->index, key);
+  }
+
+  size_t last = --table->size;
+  if (i != last) {
+    table->contacts[i] = table->contacts[last];
+    contact = &table->contacts[i];
+    key = pair_key(contact->body1, contact->body2);
+    if (hash_map_get(table->index, key) == last) {
+      hash_map_put(table->index, key, i);
+    }
+  }
+}
+
+size_t contact_table_update(contact_table_t *table,
+                            const contact_event_t **events) {
+  if (table->size > table->events_capacity) {
+    table->events_capacity = table->capacity;
+    table->events = realloc(table->events,
+                            table->events_capacity * sizeof(contact_event_t));
+    assert(table->events);
+  }
+
+  // began and persisted pairs fill the events from the front, ended pairs
+  // from the back, so each contact is visited once
+  size_t num_touching = 0;
+  size_t num_events = table->size;
+  size_t first_ended = num_events;
+  for (size_t i = 0; i < table->size;) {
+    contact_t *contact = &table->contacts[i];
+    contact_event_t event = {.body1 = contact->body1,
+                             .body2 = contact->body2,
+                             .axis = contact->axis};
+    if (contact->step != table->step && is_resting(contact)) {
+      contact->step = table->step;
+      contact->is_new = false;
+    }
+    if (contact->step == table->step) {
+      event.type = contact->is_new ? CONTACT_BEGIN : CONTACT_PERSIST;
+      table->events[num_touching++] = event;
+      i++;
+    } else {
+      event.type = CONTACT_END;
+      table->events[--first_ended] = event;
+      remove_contact(table, i);
+    }
+  }
+
+  table->step++;
+  *events = table->events;
+  return num_events;
+}
+
+void contact_table_free(contact_table_t *table) {
+  free(table->contacts);
+  hash_map_free(table->index);
+  free(table->events);
+  free(table);
+}
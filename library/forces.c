@@ -0,0 +1,185 @@
+#include "forces.h"
+#include "collision.h"
+#include "contact_table.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+/** Gravity is not applied between bodies closer together than this, since
+ * its magnitude blows up as the distance goes to 0 */
+static const double MIN_GRAVITY_DISTANCE = 5;
+
+/**
+ * The constant of a force acting between or on bodies, e.g. G or k.
+ */
+typedef struct {
+  double constant;
+} force_aux_t;
+
+/**
+ * A collision creator's handler and its arguments, and the scene's table
+ * that the pair's contact is reported to.
+ */
+typedef struct {
+  collision_handler_t handler;
+  void *aux;
+  double force_const;
+  free_func_t freer;
+  contact_table_t *contacts;
+} collision_aux_t;
+
+/**
+ * Returns a new list of one or two bodies, for scene_add_force_creator().
+ */
+static list_t *list_of_bodies(body_t *body1, body_t *body2) {
+  list_t *bodies = list_init(2, NULL);
+  list_add(bodies, body1);
+  if (body2 != NULL) {
+    list_add(bodies, body2);
+  }
+  return bodies;
+}
+
+static force_aux_t *force_aux_init(double constant) {
+  force_aux_t *aux = malloc(sizeof(force_aux_t));
+  assert(aux);
+  aux->constant = constant;
+  return aux;
+}
+
+static void newtonian_gravity(void *aux, list_t *bodies) {
+  double G = ((force_aux_t *)aux)->constant;
+  body_t *body1 = list_get(bodies, 0);
+  body_t *body2 = list_get(bodies, 1);
+  vector_t r =
+      vec_subtract(body_get_centroid(body2), body_get_centroid(body1));
+  double distance = vec_get_length(r);
+  if (distance < MIN_GRAVITY_DISTANCE) {
+    return;
+  }
+  double magnitude = G * body_get_mass(body1) * body_get_mass(body2) /
+                     (distance * distance);
+  vector_t force = vec_multiply(magnitude / distance, r);
+  body_add_force(body1, force);
+  body_add_force(body2, vec_negate(force));
+}
+
+void create_newtonian_gravity(scene_t *scene, double G, body_t *body1,
+                              body_t *body2) {
+  scene_add_force_creator(scene, newtonian_gravity, force_aux_init(G),
+                          list_of_bodies(body1, body2), free);
+}
+
+static void spring(void *aux, list_t *bodies) {
+  double k = ((force_aux_t *)aux)->constant;
+  body_t *body1 = list_get(bodies, 0);
+  body_t *body2 = list_get(bodies, 1);
+  vector_t r =
+      vec_subtract(body_get_centroid(body2), body_get_centroid(body1));
+  vector_t force = vec_multiply(k, r);
+  body_add_force(body1, force);
+  body_add_force(body2, vec_negate(force));
+}
+
+void create_spring(scene_t *scene, double k, body_t *body1, body_t *body2) {
+  scene_add_force_creator(scene, spring, force_aux_init(k),
+                          list_of_bodies(body1, body2), free);
+}
+
+static void drag(void *aux, list_t *bodies) {
+  double gamma = ((force_aux_t *)aux)->constant;
+  body_t *body = list_get(bodies, 0);
+  body_add_force(body, vec_multiply(-gamma, body_get_velocity(body)));
+}
+
+void create_drag(scene_t *scene, double gamma, body_t *body) {
+  scene_add_force_creator(scene, drag, force_aux_init(gamma),
+                          list_of_bodies(body, NULL), free);
+}
+
+static void collision_aux_free(void *aux) {
+  collision_aux_t *collision = aux;
+  if (collision->freer != NULL) {
+    collision->freer(collision->aux);
+  }
+  free(collision);
+}
+
+/**
+ * The force creator of a collision: skips the pair if its filters keep it
+ * from colliding, and otherwise tests it, reports it to the scene's contacts
+ * if it collides, and calls the handler if that contact began this tick.
+ */
+static void collision_creator(void *aux, list_t *bodies) {
+  collision_aux_t *collision = aux;
+  body_t *body1 = list_get(bodies, 0);
+  body_t *body2 = list_get(bodies, 1);
+  if (!can_collide(body_get_filter(body1), body_get_filter(body2))) {
+    return;
+  }
+  collision_info_t info = find_collision(body1, body2);
+  if (info.collided &&
+      contact_table_report(collision->contacts, body1, body2, info.axis) ==
+          CONTACT_BEGIN) {
+    collision->handler(body1, body2, info.axis, collision->aux,
+                       collision->force_const);
+  }
+}
+
+void create_collision(scene_t *scene, body_t *body1, body_t *body2,
+                      collision_handler_t handler, void *aux,
+                      double force_const, free_func_t freer) {
+  collision_aux_t *collision = malloc(sizeof(collision_aux_t));
+  assert(collision);
+  *collision = (collision_aux_t){.handler = handler,
+                                 .aux = aux,
+                                 .force_const = force_const,
+                                 .freer = freer,
+                                 .contacts = scene_get_contacts(scene)};
+  scene_add_force_creator(scene, collision_creator, collision,
+                          list_of_bodies(body1, body2), collision_aux_free);
+}
+
+static void destructive_collision(body_t *body1, body_t *body2,
+                                  vector_t axis, void *aux,
+                                  double force_const) {
+  body_remove(body1);
+  body_remove(body2);
+}
+
+void create_destructive_collision(scene_t *scene, body_t *body1,
+                                  body_t *body2) {
+  create_collision(scene, body1, body2, destructive_collision, NULL, 0, NULL);
+}
+
+/**
+ * Applies equal and opposite impulses along the collision axis, using the
+ * elasticity passed as the force constant. A body of infinite mass (see
+ * body_init_with_info()) acts as a wall, so the reduced mass is the other
+ * body's mass.
+ */
+static void physics_collision(body_t *body1, body_t *body2, vector_t axis,
+                              void *aux, double elasticity) {
+  double mass1 = body_get_mass(body1);
+  double mass2 = body_get_mass(body2);
+  double reduced_mass;
+  if (mass1 >= __DBL_MAX__) {
+    reduced_mass = mass2;
+  } else if (mass2 >= __DBL_MAX__) {
+    reduced_mass = mass1;
+  } else {
+    reduced_mass = mass1 * mass2 / (mass1 + mass2);
+  }
+  double u1 = vec_dot(body_get_velocity(body1), axis);
+  double u2 = vec_dot(body_get_velocity(body2), axis);
+  double impulse = reduced_mass * (1 + elasticity) * (u2 - u1);
+  body_add_impulse(body1, vec_multiply(impulse, axis));
+  body_add_impulse(body2, vec_multiply(-impulse, axis));
+}
+
+void create_physics_collision(scene_t *scene, body_t *body1, body_t *body2,
+                              double elasticity) {
+  create_collision(scene, body1, body2, physics_collision, NULL, elasticity,
+                   NULL);
+}
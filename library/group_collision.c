@@ -0,0 +1,275 @@
+#include "body_handle.h"
+#include "collision.h"
+#include "contact_table.h"
+#include "forces.h"
+#include "hash_map.h"
+#include "shape_view.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/** Initial capacity of a group's member arrays */
+static const size_t INIT_GROUP_CAPACITY = 8;
+
+/**
+ * The members are kept in parallel arrays. A member's pointer is only
+ * dereferenced while its handle still resolves; once the handle is revoked
+ * the pointer is only used to forget the member's cached pairs, and to find
+ * the member's index in the map.
+ */
+struct collision_group {
+  body_t *body;
+  collision_handler_t handler;
+  void *aux;
+  double force_const;
+  free_func_t freer;
+
+  body_handle_t *handles;
+  body_t **members;
+  size_t size;
+  size_t capacity;
+  /** Maps each member's address to its index in the arrays */
+  hash_map_t *index;
+
+  /** Finds the body's candidates, or NULL to check every member's bounds */
+  broadphase_query_t query;
+  void *query_aux;
+  collision_filter_t query_filter;
+
+  /** Scratch space for each tick's candidates and hits, kept between ticks
+   * and grown when a tick needs more */
+  body_t **candidates;
+  collision_hit_t *hits;
+  size_t buffer_capacity;
+
+  /** Pairs of the body and its members, remembered across ticks */
+  collision_cache_t *cache;
+  /** The scene's contacts, which the group reports its hits to */
+  contact_table_t *contacts;
+};
+
+static void collision_group_free(collision_group_t *group) {
+  if (group->freer != NULL) {
+    group->freer(group->aux);
+  }
+  free(group->handles);
+  free(group->members);
+  free(group->candidates);
+  free(group->hits);
+  hash_map_free(group->index);
+  collision_cache_free(group->cache);
+  free(group);
+}
+
+/**
+ * Removes the member at an index by moving the last member into its place.
+ */
+static void remove_member(collision_group_t *group, size_t index) {
+  collision_cache_remove(group->cache, group->members[index]);
+  hash_map_remove(group->index, (uintptr_t)group->members[index]);
+  size_t last = --group->size;
+  if (index != last) {
+    group->handles[index] = group->handles[last];
+    group->members[index] = group->members[last];
+    hash_map_put(group->index, (uintptr_t)group->members[index], index);
+  }
+}
+
+/**
+ * Removes every member whose handle has been revoked.
+ */
+static void prune_members(collision_group_t *group) {
+  for (size_t i = 0; i < group->size; i++) {
+    if (body_handle_resolve(group->handles[i]) == NULL) {
+      remove_member(group, i--);
+    }
+  }
+}
+
+/**
+ * Returns whether two bounding boxes overlap, counting boxes that only touch.
+ */
+static bool bounds_overlap(vector_t min1, vector_t max1, vector_t min2,
+                           vector_t max2) {
+  return min1.x <= max2.x && min2.x <= max1.x && min1.y <= max2.y &&
+         min2.y <= max1.y;
+}
+
+/**
+ * Finds the members whose bounding boxes overlap the body's by checking each
+ * member's bounds, dropping removed members along the way.
+ *
+ * @param candidates filled with the members found
+ * @return the number of members found
+ */
+static size_t scan_members(collision_group_t *group, body_t **candidates) {
+  vector_t min;
+  vector_t max;
+  shape_view_get_bounds(group->body, &min, &max);
+  size_t num_candidates = 0;
+  for (size_t i = 0; i < group->size; i++) {
+    if (body_handle_resolve(group->handles[i]) == NULL) {
+      remove_member(group, i--);
+      continue;
+    }
+    body_t *member = group->members[i];
+    vector_t member_min;
+    vector_t member_max;
+    shape_view_get_bounds(member, &member_min, &member_max);
+    if (!body_is_removed(member) &&
+        bounds_overlap(min, max, member_min, member_max)) {
+      candidates[num_candidates++] = member;
+    }
+  }
+  return num_candidates;
+}
+
+/**
+ * Keeps the bodies found by the group's broadphase query that are members,
+ * dropping removed members that come up.
+ *
+ * @param nearby the bodies the query found
+ * @param candidates filled with the members among them
+ * @return the number of members found
+ */
+static size_t filter_members(collision_group_t *group, list_t *nearby,
+                             body_t **candidates) {
+  size_t num_candidates = 0;
+  for (size_t i = 0; i < list_size(nearby); i++) {
+    body_t *body = list_get(nearby, i);
+    size_t index = hash_map_get(group->index, (uintptr_t)body);
+    if (index == HASH_MAP_NONE) {
+      continue;
+    }
+    // the address may belong to a new body since the member was removed
+    if (body_handle_resolve(group->handles[index]) != body) {
+      remove_member(group, index);
+      continue;
+    }
+    if (!body_is_removed(body)) {
+      candidates[num_candidates++] = body;
+    }
+  }
+  return num_candidates;
+}
+
+/**
+ * Makes room for a number of candidates and hits in a group's buffers,
+ * growing them if they are too small.
+ */
+static void reserve_buffers(collision_group_t *group, size_t count) {
+  if (count <= group->buffer_capacity) {
+    return;
+  }
+  size_t capacity =
+      group->buffer_capacity ? group->buffer_capacity : INIT_GROUP_CAPACITY;
+  while (capacity < count) {
+    capacity *= 2;
+  }
+  group->candidates =
+      realloc(group->candidates, capacity * sizeof(body_t *));
+  group->hits = realloc(group->hits, capacity * sizeof(collision_hit_t));
+  assert(group->candidates && group->hits);
+  group->buffer_capacity = capacity;
+}
+
+/**
+ * The force creator of a collision group: finds the members near the body,
+ * tests them in one batch, reports the hits to the scene's contacts, and
+ * calls the handler for each contact that began this tick.
+ */
+static void group_collision_creator(void *aux, list_t *bodies) {
+  collision_group_t *group = aux;
+  list_t *nearby = NULL;
+  size_t count = group->size;
+  if (group->query != NULL) {
+    nearby = group->query(group->query_aux, group->body, group->query_filter);
+    count = list_size(nearby);
+  }
+  reserve_buffers(group, count);
+  body_t **candidates = group->candidates;
+  size_t num_candidates;
+  if (nearby != NULL) {
+    num_candidates = filter_members(group, nearby, candidates);
+    list_free(nearby);
+  } else {
+    num_candidates = scan_members(group, candidates);
+  }
+
+  if (num_candidates == 0) {
+    return;
+  }
+  collision_hit_t *hits = group->hits;
+  size_t num_hits = find_collisions(group->cache, group->body, candidates,
+                                    num_candidates, hits);
+  for (size_t i = 0; i < num_hits; i++) {
+    body_t *member = candidates[hits[i].index];
+    if (contact_table_report(group->contacts, group->body, member,
+                             hits[i].axis) == CONTACT_BEGIN) {
+      group->handler(group->body, member, hits[i].axis, group->aux,
+                     group->force_const);
+    }
+  }
+}
+
+collision_group_t *create_group_collision(scene_t *scene, body_t *body,
+                                          collision_handler_t handler,
+                                          void *aux, double force_const,
+                                          free_func_t freer) {
+  collision_group_t *group = malloc(sizeof(collision_group_t));
+  assert(group);
+  *group = (collision_group_t){.body = body,
+                               .handler = handler,
+                               .aux = aux,
+                               .force_const = force_const,
+                               .freer = freer,
+                               .index = hash_map_init(INIT_GROUP_CAPACITY),
+                               .cache = collision_cache_init(),
+                               .contacts = scene_get_contacts(scene)};
+
+  list_t *bodies = list_init(1, NULL);
+  list_add(bodies, body);
+  scene_add_force_creator(scene, group_collision_creator, group, bodies,
+                          (free_func_t)collision_group_free);
+  return group;
+}
+
+void collision_group_set_broadphase(collision_group_t *group,
+                                    broadphase_query_t query, void *query_aux,
+                                    collision_filter_t filter) {
+  group->query = query;
+  group->query_aux = query_aux;
+  group->query_filter = filter;
+}
+
+void collision_group_add(collision_group_t *group, body_t *member) {
+  // a removed member freed since its last test may have had this address
+  collision_cache_remove(group->cache, member);
+  size_t index = hash_map_get(group->index, (uintptr_t)member);
+  if (index != HASH_MAP_NONE) {
+    group->handles[index] = body_handle_issue(member);
+    return;
+  }
+
+  if (group->size == group->capacity) {
+    // with a broadphase, removed members far from the body are never
+    // visited, so drop them before deciding to grow
+    prune_members(group);
+    // grow unless half the arrays were freed, so pruning stays amortized
+    if (2 * group->size >= group->capacity) {
+      group->capacity =
+          group->capacity ? group->capacity * 2 : INIT_GROUP_CAPACITY;
+      group->handles =
+          realloc(group->handles, group->capacity * sizeof(body_handle_t));
+      group->members =
+          realloc(group->members, group->capacity * sizeof(body_t *));
+      assert(group->handles && group->members);
+    }
+  }
+  hash_map_put(group->index, (uintptr_t)member, group->size);
+  group->handles[group->size] = body_handle_issue(member);
+  group->members[group->size] = member;
+  group->size++;
+}
@@ -0,0 +1,149 @@
+#include "hash_map.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+/** The smallest number of slots a map has; must be a power of two */
+static const size_t MIN_CAPACITY = 16;
+
+const size_t HASH_MAP_NONE = SIZE_MAX;
+
+/**
+ * A slot of the table. A slot is empty when its value is HASH_MAP_NONE.
+ */
+typedef struct {
+  uint64_t key;
+  size_t value;
+} slot_t;
+
+/**
+ * Uses linear probing, with keys scattered by Fibonacci hashing: multiplying
+ * by 2^64 divided by the golden ratio and keeping the top bits, so keys that
+ * differ only in their low bits, like nearby addresses, land far apart.
+ */
+struct hash_map {
+  slot_t *slots;
+  size_t capacity;
+  /** 64 minus the base 2 logarithm of the capacity */
+  unsigned shift;
+  size_t size;
+};
+
+/**
+ * Returns the slot a key's probe sequence starts at.
+ */
+static size_t home_slot(hash_map_t *map, uint64_t key) {
+  return (size_t)((key * 11400714819323198485ull) >> map->shift);
+}
+
+/**
+ * Returns the slot where a key is, or would be, stored.
+ */
+static size_t find_slot(hash_map_t *map, uint64_t key) {
+  size_t mask = map->capacity - 1;
+  size_t slot = home_slot(map, key);
+  while (map->slots[slot].value != HASH_MAP_NONE &&
+         map->slots[slot].key != key) {
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+/**
+ * Allocates a map's table with the given capacity, with every slot empty.
+ */
+static void init_slots(hash_map_t *map, size_t capacity) {
+  map->slots = malloc(capacity * sizeof(slot_t));
+  assert(map->slots);
+  map->capacity = capacity;
+  map->shift = 64;
+  for (size_t i = capacity; i > 1; i /= 2) {
+    map->shift--;
+  }
+  hash_map_clear(map);
+}
+
+/**
+ * Rehashes a map into a table with the given capacity.
+ */
+static void resize(hash_map_t *map, size_t capacity) {
+  slot_t *old_slots = map->slots;
+  size_t old_capacity = map->capacity;
+  size_t size = map->size;
+  init_slots(map, capacity);
+  for (size_t i = 0; i < old_capacity; i++) {
+    if (old_slots[i].value != HASH_MAP_NONE) {
+      map->slots[find_slot(map, old_slots[i].key)] = old_slots[i];
+    }
+  }
+  map->size = size;
+  free(old_slots);
+}
+
+hash_map_t *hash_map_init(size_t initial_size) {
+  hash_map_t *map = malloc(sizeof(hash_map_t));
+  assert(map);
+  size_t capacity = MIN_CAPACITY;
+  while (capacity < 2 * initial_size) {
+    capacity *= 2;
+  }
+  init_slots(map, capacity);
+  return map;
+}
+
+size_t hash_map_get(hash_map_t *map, uint64_t key) {
+  return map->slots[find_slot(map, key)].value;
+}
+
+void hash_map_put(hash_map_t *map, uint64_t key, size_t value) {
+  assert(value != HASH_MAP_NONE);
+  size_t slot = find_slot(map, key);
+  if (map->slots[slot].value == HASH_MAP_NONE) {
+    // keep the table at most half full so probe sequences stay short
+    if (2 * (map->size + 1) > map->capacity) {
+      resize(map, map->capacity * 2);
+      slot = find_slot(map, key);
+    }
+    map->slots[slot].key = key;
+    map->size++;
+  }
+  map->slots[slot].value = value;
+}
+
+size_t hash_map_remove(hash_map_t *map, uint64_t key) {
+  size_t slot = find_slot(map, key);
+  size_t value = map->slots[slot].value;
+  if (value == HASH_MAP_NONE) {
+    return HASH_MAP_NONE;
+  }
+  map->size--;
+
+  // shift later keys in the probe sequence back into the hole, unless that
+  // would move one before its home slot, so lookups never stop early
+  size_t mask = map->capacity - 1;
+  size_t hole = slot;
+  for (size_t next = (hole + 1) & mask;
+       map->slots[next].value != HASH_MAP_NONE; next = (next + 1) & mask) {
+    size_t home = home_slot(map, map->slots[next].key);
+    if (((next - home) & mask) >= ((next - hole) & mask)) {
+      map->slots[hole] = map->slots[next];
+      hole = next;
+    }
+  }
+  map->slots[hole].value = HASH_MAP_NONE;
+  return value;
+}
+
+size_t hash_map_size(hash_map_t *map) { return map->size; }
+
+void hash_map_clear(hash_map_t *map) {
+  for (size_t i = 0; i < map->capacity; i++) {
+    map->slots[i].value = HASH_MAP_NONE;
+  }
+  map->size = 0;
+}
+
+void hash_map_free(hash_map_t *map) {
+  free(map->slots);
+  free(map);
+}
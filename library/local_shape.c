@@ -0,0 +1,128 @@
+#include "local_shape.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/** Initial capacity of the list of live shapes */
+static const size_t INIT_SHAPES_CAPACITY = 8;
+
+struct local_shape {
+  vector_t *vertices;
+  double *x;
+  double *y;
+  vector_t *normals;
+  size_t size;
+  size_t references;
+};
+
+/**
+ * Every shape with at least one reference, so identical shapes can be found
+ * and shared. Levels only use a handful of distinct shapes, so it is searched
+ * linearly. The list does not own the shapes.
+ */
+static list_t *SHAPES = NULL;
+
+/**
+ * Returns whether a shape has exactly the given vertices.
+ */
+static bool has_vertices(const local_shape_t *shape, const vector_t *vertices,
+                         size_t size) {
+  if (shape->size != size) {
+    return false;
+  }
+  for (size_t i = 0; i < size; i++) {
+    if (shape->vertices[i].x != vertices[i].x ||
+        shape->vertices[i].y != vertices[i].y) {
+      return false;
+    }
+  }
+  return true;
+}
+
+local_shape_t *local_shape_get(const vector_t *vertices, size_t size) {
+  assert(size >= 3);
+  if (SHAPES == NULL) {
+    SHAPES = list_init(INIT_SHAPES_CAPACITY, NULL);
+  }
+  for (size_t i = 0; i < list_size(SHAPES); i++) {
+    local_shape_t *shape = list_get(SHAPES, i);
+    if (has_vertices(shape, vertices, size)) {
+      return local_shape_retain(shape);
+    }
+  }
+
+  local_shape_t *shape = malloc(sizeof(local_shape_t));
+  assert(shape);
+  shape->vertices = malloc(size * sizeof(vector_t));
+  shape->x = malloc(size * sizeof(double));
+  shape->y = malloc(size * sizeof(double));
+  shape->normals = malloc(size * sizeof(vector_t));
+  assert(shape->vertices && shape->x && shape->y && shape->normals);
+  shape->size = size;
+  shape->references = 1;
+  for (size_t i = 0; i < size; i++) {
+    shape->vertices[i] = vertices[i];
+    shape->x[i] = vertices[i].x;
+    shape->y[i] = vertices[i].y;
+  }
+  for (size_t i = 0; i < size; i++) {
+    vector_t edge = vec_subtract(vertices[i], vertices[(i + 1) % size]);
+    vector_t axis = {.x = -edge.y, .y = edge.x};
+    shape->normals[i] = vec_multiply(1 / vec_get_length(axis), axis);
+  }
+  list_add(SHAPES, shape);
+  return shape;
+}
+
+local_shape_t *local_shape_retain(local_shape_t *shape) {
+  shape->references++;
+  return shape;
+}
+
+void local_shape_release(local_shape_t *shape) {
+  assert(shape->references > 0);
+  if (--shape->references > 0) {
+    return;
+  }
+  for (size_t i = 0; i < list_size(SHAPES); i++) {
+    if (list_get(SHAPES, i) == shape) {
+      list_remove(SHAPES, i);
+      break;
+    }
+  }
+  if (list_size(SHAPES) == 0) {
+    list_free(SHAPES);
+    SHAPES = NULL;
+  }
+  free(shape->vertices);
+  free(shape->x);
+  free(shape->y);
+  free(shape->normals);
+  free(shape);
+}
+
+size_t local_shape_size(const local_shape_t *shape) { return shape->size; }
+
+const vector_t *local_shape_vertices(const local_shape_t *shape) {
+  return shape->vertices;
+}
+
+const double *local_shape_x(const local_shape_t *shape) { return shape->x; }
+
+const double *local_shape_y(const local_shape_t *shape) { return shape->y; }
+
+const vector_t *local_shape_normals(const local_shape_t *shape) {
+  return shape->normals;
+}
+
+list_t *local_shape_place(const local_shape_t *shape, vector_t centroid) {
+  list_t *vertices = list_init(shape->size, free);
+  for (size_t i = 0; i < shape->size; i++) {
+    vector_t *vertex = malloc(sizeof(vector_t));
+    assert(vertex);
+    *vertex = vec_add(centroid, shape->vertices[i]);
+    list_add(vertices, vertex);
+  }
+  return vertices;
+}
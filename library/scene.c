@@ -0,0 +1,575 @@
+#include "scene.h"
+#include "body_handle.h"
+#include "bvh.h"
+#include "collision.h"
+#include "hash_map.h"
+#include "shape_view.h"
+#include "spatial_hash.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/** Initial capacity of a scene's body and force creator lists, and of each
+ * body's list of force creators */
+static const size_t INIT_SCENE_CAPACITY = 16;
+static const size_t INIT_BODY_CREATORS_CAPACITY = 2;
+/** How far into an obstacle a body stopped from tunneling is left, past where
+ * it first touched, so rounding cannot stop the next tick's tests from seeing
+ * the contact */
+static const double TUNNELING_SKIN = 0.01;
+
+/**
+ * A force creator, along with the bodies that remove it when they are
+ * removed.
+ * A removed creator has already had its aux value freed; it is left in the
+ * scene's list until the next scene_tick() passes over it.
+ */
+typedef struct {
+  force_creator_t forcer;
+  void *aux;
+  list_t *bodies;
+  free_func_t freer;
+  /** Where the creator is in the creator list of each of its bodies */
+  size_t *positions;
+  bool removed;
+} creator_t;
+
+/**
+ * One entry of a body's creator list: a creator, and which of its bodies
+ * the list belongs to.
+ */
+typedef struct {
+  creator_t *creator;
+  size_t body_index;
+} creator_ref_t;
+
+/**
+ * The force creators acting on a body, so removing the body only visits
+ * its own creators.
+ */
+typedef struct {
+  body_t *body;
+  creator_ref_t *creators;
+  size_t size;
+  size_t capacity;
+} body_creators_t;
+
+/**
+ * Where a body was filed in the broadphase: its version at the time, and
+ * whether it was static, and so filed in the hierarchy rather than the hash.
+ */
+typedef struct {
+  uint64_t version;
+  bool is_static;
+} filing_t;
+
+/**
+ * The bodies are kept in the order they were added, while their positions,
+ * velocities and forces live in the store, so scene_tick() can integrate them
+ * all in one pass over its arrays.
+ * Removed bodies are dropped from the body list in a single pass that keeps
+ * the rest in order. Their force creators are found through each body's
+ * creator list, and are dropped from the creator list the next time
+ * scene_tick() calls the creators.
+ * A scene with a broadphase files each static body in a bounding volume
+ * hierarchy, and every other body in a spatial hash. At the end of each
+ * scene_tick() it refiles the bodies whose versions or kinds have changed.
+ * The hierarchy cannot be updated, so it is rebuilt by the first query after
+ * a static body is added, moved or removed.
+ */
+struct scene {
+  body_t **bodies;
+  /** How each body was last filed in the broadphase */
+  filing_t *filings;
+  size_t num_bodies;
+  size_t bodies_capacity;
+  body_store_t *store;
+  creator_t **creators;
+  size_t num_creators;
+  size_t creators_capacity;
+  /** The creator list of each body with creators, kept dense, and a map
+   * from each body to its index in the array */
+  body_creators_t *body_creators;
+  size_t num_body_creators;
+  size_t body_creators_capacity;
+  hash_map_t *body_index;
+  /** The broadphase, or NULL if the scene has none */
+  spatial_hash_t *grid;
+  bvh_t *geometry;
+  /** Whether the static bodies have changed since the hierarchy was built */
+  bool geometry_changed;
+  /** The pairs the collision creators found touching, and the events of the
+   * last update */
+  contact_table_t *contacts;
+  const contact_event_t *events;
+  size_t num_events;
+};
+
+static void creator_free(creator_t *creator) {
+  if (!creator->removed && creator->freer != NULL) {
+    creator->freer(creator->aux);
+  }
+  list_free(creator->bodies);
+  free(creator->positions);
+  free(creator);
+}
+
+scene_t *scene_init(void) {
+  scene_t *scene = malloc(sizeof(scene_t));
+  assert(scene);
+  scene->bodies = malloc(INIT_SCENE_CAPACITY * sizeof(body_t *));
+  scene->filings = malloc(INIT_SCENE_CAPACITY * sizeof(filing_t));
+  scene->creators = malloc(INIT_SCENE_CAPACITY * sizeof(creator_t *));
+  assert(scene->bodies && scene->filings && scene->creators);
+  scene->num_bodies = 0;
+  scene->bodies_capacity = INIT_SCENE_CAPACITY;
+  scene->num_creators = 0;
+  scene->creators_capacity = INIT_SCENE_CAPACITY;
+  scene->store = body_store_init(INIT_SCENE_CAPACITY);
+  scene->body_creators =
+      malloc(INIT_SCENE_CAPACITY * sizeof(body_creators_t));
+  assert(scene->body_creators);
+  scene->num_body_creators = 0;
+  scene->body_creators_capacity = INIT_SCENE_CAPACITY;
+  scene->body_index = hash_map_init(INIT_SCENE_CAPACITY);
+  scene->grid = NULL;
+  scene->geometry = NULL;
+  scene->geometry_changed = false;
+  scene->contacts = contact_table_init();
+  scene->events = NULL;
+  scene->num_events = 0;
+  return scene;
+}
+
+size_t scene_bodies(scene_t *scene) { return scene->num_bodies; }
+
+body_t *scene_get_body(scene_t *scene, size_t index) {
+  assert(index < scene->num_bodies);
+  return scene->bodies[index];
+}
+
+/**
+ * Files a body in a scene's broadphase, if it has one.
+ *
+ * @return how the body was filed
+ */
+static filing_t file_body(scene_t *scene, body_t *body) {
+  filing_t filing = {.version = body_get_version(body),
+                     .is_static = body_get_kind(body) == BODY_STATIC};
+  if (scene->grid == NULL) {
+    return filing;
+  }
+  if (filing.is_static) {
+    scene->geometry_changed = true;
+  } else {
+    spatial_hash_add(scene->grid, body, body_get_filter(body));
+  }
+  return filing;
+}
+
+void scene_add_body(scene_t *scene, body_t *body) {
+  if (scene->num_bodies == scene->bodies_capacity) {
+    scene->bodies_capacity *= 2;
+    scene->bodies =
+        realloc(scene->bodies, scene->bodies_capacity * sizeof(body_t *));
+    scene->filings =
+        realloc(scene->filings, scene->bodies_capacity * sizeof(filing_t));
+    assert(scene->bodies && scene->filings);
+  }
+  body_store_add(scene->store, body);
+  body_handle_issue(body);
+  scene->filings[scene->num_bodies] = file_body(scene, body);
+  scene->bodies[scene->num_bodies++] = body;
+}
+
+void scene_remove_body(scene_t *scene, size_t index) {
+  body_remove(scene_get_body(scene, index));
+}
+
+/**
+ * Returns a body's creator list, adding an empty one if it has none.
+ */
+static body_creators_t *get_body_creators(scene_t *scene, body_t *body) {
+  size_t i = hash_map_get(scene->body_index, (uintptr_t)body);
+  if (i != HASH_MAP_NONE) {
+    return &scene->body_creators[i];
+  }
+  if (scene->num_body_creators == scene->body_creators_capacity) {
+    scene->body_creators_capacity *= 2;
+    scene->body_creators =
+        realloc(scene->body_creators,
+                scene->body_creators_capacity * sizeof(body_creators_t));
+    assert(scene->body_creators);
+  }
+  i = scene->num_body_creators++;
+  scene->body_creators[i] = (body_creators_t){.body = body};
+  hash_map_put(scene->body_index, (uintptr_t)body, i);
+  return &scene->body_creators[i];
+}
+
+void scene_add_force_creator(scene_t *scene, force_creator_t force_creator,
+                             void *aux, list_t *bodies, free_func_t freer) {
+  if (scene->num_creators == scene->creators_capacity) {
+    scene->creators_capacity *= 2;
+    scene->creators = realloc(scene->creators,
+                              scene->creators_capacity * sizeof(creator_t *));
+    assert(scene->creators);
+  }
+  creator_t *creator = malloc(sizeof(creator_t));
+  assert(creator);
+  creator->forcer = force_creator;
+  creator->aux = aux;
+  creator->bodies = bodies;
+  creator->freer = freer;
+  creator->positions = malloc(list_size(bodies) * sizeof(size_t));
+  assert(creator->positions || list_size(bodies) == 0);
+  creator->removed = false;
+  scene->creators[scene->num_creators++] = creator;
+
+  for (size_t i = 0; i < list_size(bodies); i++) {
+    body_creators_t *record = get_body_creators(scene, list_get(bodies, i));
+    if (record->size == record->capacity) {
+      record->capacity = record->capacity ? record->capacity * 2
+                                          : INIT_BODY_CREATORS_CAPACITY;
+      record->creators =
+          realloc(record->creators, record->capacity * sizeof(creator_ref_t));
+      assert(record->creators);
+    }
+    creator->positions[i] = record->size;
+    record->creators[record->size++] =
+        (creator_ref_t){.creator = creator, .body_index = i};
+  }
+}
+
+/**
+ * Removes a force creator from the creator lists of its bodies and frees its
+ * aux value. The creator itself is freed by the next scene_tick().
+ */
+static void remove_creator(scene_t *scene, creator_t *creator) {
+  for (size_t i = 0; i < list_size(creator->bodies); i++) {
+    size_t index = hash_map_get(scene->body_index,
+                                (uintptr_t)list_get(creator->bodies, i));
+    body_creators_t *record = &scene->body_creators[index];
+    // move the last entry into the freed place
+    creator_ref_t last = record->creators[--record->size];
+    record->creators[creator->positions[i]] = last;
+    last.creator->positions[last.body_index] = creator->positions[i];
+  }
+  if (creator->freer != NULL) {
+    creator->freer(creator->aux);
+  }
+  creator->removed = true;
+}
+
+/**
+ * Removes the force creators acting on a removed body, and its creator list.
+ */
+static void remove_body_creators(scene_t *scene, body_t *body) {
+  size_t index = hash_map_get(scene->body_index, (uintptr_t)body);
+  if (index == HASH_MAP_NONE) {
+    return;
+  }
+  body_creators_t *record = &scene->body_creators[index];
+  while (record->size > 0) {
+    remove_creator(scene, record->creators[record->size - 1].creator);
+  }
+  free(record->creators);
+  hash_map_remove(scene->body_index, (uintptr_t)body);
+
+  // keep the creator lists dense by moving the last into the freed place
+  size_t last = --scene->num_body_creators;
+  if (index != last) {
+    scene->body_creators[index] = scene->body_creators[last];
+    hash_map_put(scene->body_index,
+                 (uintptr_t)scene->body_creators[index].body, index);
+  }
+}
+
+/**
+ * Drops every removed body from a scene, keeping the rest in order, along
+ * with every force creator acting on one, then revokes the bodies' handles
+ * and frees them.
+ */
+static void remove_bodies(scene_t *scene) {
+  size_t num_removed;
+  body_t *const *removed = body_store_get_removed(scene->store, &num_removed);
+  if (num_removed == 0) {
+    return;
+  }
+
+  for (size_t i = 0; i < num_removed; i++) {
+    remove_body_creators(scene, removed[i]);
+  }
+
+  size_t num_kept = 0;
+  for (size_t i = 0; i < scene->num_bodies; i++) {
+    if (!body_is_removed(scene->bodies[i])) {
+      scene->filings[num_kept] = scene->filings[i];
+      scene->bodies[num_kept++] = scene->bodies[i];
+    } else if (scene->filings[i].is_static) {
+      scene->geometry_changed = true;
+    }
+  }
+  scene->num_bodies = num_kept;
+
+  for (size_t i = 0; i < num_removed; i++) {
+    if (scene->grid != NULL) {
+      spatial_hash_remove(scene->grid, removed[i]);
+    }
+    body_handle_revoke(removed[i]);
+    body_free(removed[i]);
+  }
+  body_store_clear_removed(scene->store);
+}
+
+void scene_set_sleeping(scene_t *scene, double speed, size_t ticks) {
+  body_store_set_sleeping(scene->store, speed, ticks);
+}
+
+contact_table_t *scene_get_contacts(scene_t *scene) {
+  return scene->contacts;
+}
+
+size_t scene_get_contact_events(scene_t *scene,
+                                const contact_event_t **events) {
+  *events = scene->events;
+  return scene->num_events;
+}
+
+void scene_set_broadphase(scene_t *scene, double cell_size) {
+  assert(scene->grid == NULL);
+  scene->grid = spatial_hash_init(cell_size);
+  // the first query builds the hierarchy, even if it is empty
+  scene->geometry_changed = true;
+  for (size_t i = 0; i < scene->num_bodies; i++) {
+    scene->filings[i] = file_body(scene, scene->bodies[i]);
+  }
+}
+
+/**
+ * Refiles the bodies that have moved, turned, changed shape or changed to or
+ * from static since they were last filed in the broadphase.
+ */
+static void refile_bodies(scene_t *scene) {
+  if (scene->grid == NULL) {
+    return;
+  }
+  for (size_t i = 0; i < scene->num_bodies; i++) {
+    body_t *body = scene->bodies[i];
+    filing_t *filing = &scene->filings[i];
+    bool is_static = body_get_kind(body) == BODY_STATIC;
+    if (is_static != filing->is_static) {
+      if (is_static) {
+        spatial_hash_remove(scene->grid, body);
+      } else {
+        spatial_hash_add(scene->grid, body, body_get_filter(body));
+      }
+      scene->geometry_changed = true;
+    } else if (body_get_version(body) != filing->version) {
+      if (is_static) {
+        scene->geometry_changed = true;
+      } else {
+        spatial_hash_update(scene->grid, body);
+      }
+    }
+    *filing = (filing_t){.version = body_get_version(body),
+                         .is_static = is_static};
+  }
+}
+
+/**
+ * Rebuilds a scene's hierarchy over its static bodies, if they have changed
+ * since it was last built.
+ */
+static void update_geometry(scene_t *scene) {
+  if (!scene->geometry_changed) {
+    return;
+  }
+  list_t *bodies = list_init(INIT_SCENE_CAPACITY, NULL);
+  for (size_t i = 0; i < scene->num_bodies; i++) {
+    if (scene->filings[i].is_static) {
+      list_add(bodies, scene->bodies[i]);
+    }
+  }
+  if (scene->geometry != NULL) {
+    bvh_free(scene->geometry);
+  }
+  scene->geometry = bvh_init(bodies);
+  list_free(bodies);
+  scene->geometry_changed = false;
+}
+
+/**
+ * Finds the bodies filed near a box, leaving out one body, if it is not
+ * NULL, and the bodies marked for removal, which stay filed until the end of
+ * the tick.
+ */
+static list_t *query(scene_t *scene, vector_t min, vector_t max,
+                     collision_filter_t filter, body_t *except) {
+  assert(scene->grid != NULL);
+  update_geometry(scene);
+  list_t *bodies = spatial_hash_query(scene->grid, min, max, filter);
+  list_t *geometry = bvh_query(scene->geometry, min, max, filter);
+  for (size_t i = 0; i < list_size(geometry); i++) {
+    list_add(bodies, list_get(geometry, i));
+  }
+  list_free(geometry);
+  for (size_t i = list_size(bodies); i-- > 0;) {
+    body_t *body = list_get(bodies, i);
+    if (body == except || body_is_removed(body)) {
+      list_remove(bodies, i);
+    }
+  }
+  return bodies;
+}
+
+list_t *scene_query(scene_t *scene, vector_t min, vector_t max,
+                    collision_filter_t filter) {
+  return query(scene, min, max, filter, NULL);
+}
+
+list_t *scene_query_body(scene_t *scene, body_t *body,
+                         collision_filter_t filter) {
+  vector_t min;
+  vector_t max;
+  shape_view_get_bounds(body, &min, &max);
+  return query(scene, min, max, filter, body);
+}
+
+/**
+ * If a body passed all the way through something it collides with during
+ * the last tick, moves it back to where it first touched the first such
+ * thing, so the collision tests see the contact on the next tick.
+ * Things the body still overlaps are left to those tests.
+ */
+static void stop_tunneling(scene_t *scene, body_t *body) {
+  vector_t start = body_get_previous_centroid(body);
+  vector_t displacement = vec_subtract(body_get_centroid(body), start);
+  if (displacement.x == 0 && displacement.y == 0) {
+    return;
+  }
+  vector_t end_min;
+  vector_t end_max;
+  shape_view_get_bounds(body, &end_min, &end_max);
+  vector_t start_min = vec_subtract(end_min, displacement);
+  vector_t start_max = vec_subtract(end_max, displacement);
+  vector_t swept_min = {fmin(start_min.x, end_min.x),
+                        fmin(start_min.y, end_min.y)};
+  vector_t swept_max = {fmax(start_max.x, end_max.x),
+                        fmax(start_max.y, end_max.y)};
+
+  list_t *obstacles =
+      query(scene, swept_min, swept_max, body_get_filter(body), body);
+  double first_impact = 1;
+  for (size_t i = 0; i < list_size(obstacles); i++) {
+    vector_t min;
+    vector_t max;
+    shape_view_get_bounds(list_get(obstacles, i), &min, &max);
+    bool passed_through = min.x > end_max.x || end_min.x > max.x ||
+                          min.y > end_max.y || end_min.y > max.y;
+    double time;
+    vector_t normal;
+    if (passed_through &&
+        find_time_of_impact(start_min, start_max, displacement, min, max,
+                            &time, &normal) &&
+        time < first_impact) {
+      first_impact = time;
+    }
+  }
+  list_free(obstacles);
+
+  if (first_impact < 1) {
+    // exactly at the time of impact the shapes only just touch
+    double skin = TUNNELING_SKIN / sqrt(vec_dot(displacement, displacement));
+    double time = fmin(first_impact + skin, 1);
+    body_set_centroid(body, vec_add(start, vec_multiply(time, displacement)));
+  }
+}
+
+/**
+ * Stops each continuous body in a scene with a broadphase from tunneling
+ * during the last tick (see body_set_continuous()).
+ */
+static void stop_continuous_bodies(scene_t *scene) {
+  if (scene->grid == NULL) {
+    return;
+  }
+  for (size_t i = 0; i < scene->num_bodies; i++) {
+    body_t *body = scene->bodies[i];
+    if (body_is_continuous(body) && !body_is_removed(body)) {
+      stop_tunneling(scene, body);
+    }
+  }
+}
+
+/**
+ * Returns whether a creator's bodies are all asleep, apart from static
+ * bodies, which never wake. Such a creator is not called, so it neither
+ * wakes its bodies nor reports anything new about them.
+ * A creator with no bodies, or only static ones, is never asleep.
+ */
+static bool is_asleep(creator_t *creator) {
+  bool any_asleep = false;
+  for (size_t i = 0; i < list_size(creator->bodies); i++) {
+    body_t *body = list_get(creator->bodies, i);
+    if (body_is_sleeping(body)) {
+      any_asleep = true;
+    } else if (body_get_kind(body) != BODY_STATIC) {
+      return false;
+    }
+  }
+  return any_asleep;
+}
+
+void scene_tick(scene_t *scene, double dt) {
+  // drop the creators removed since the last tick while calling the rest;
+  // a creator may add more, which are called and kept in turn
+  size_t num_kept = 0;
+  for (size_t i = 0; i < scene->num_creators; i++) {
+    creator_t *creator = scene->creators[i];
+    if (creator->removed) {
+      creator_free(creator);
+      continue;
+    }
+    scene->creators[num_kept++] = creator;
+    if (!is_asleep(creator)) {
+      creator->forcer(creator->aux, creator->bodies);
+    }
+  }
+  scene->num_creators = num_kept;
+  scene->num_events = contact_table_update(scene->contacts, &scene->events);
+  body_store_tick(scene->store, dt);
+  stop_continuous_bodies(scene);
+  remove_bodies(scene);
+  refile_bodies(scene);
+}
+
+void scene_free(scene_t *scene) {
+  for (size_t i = 0; i < scene->num_creators; i++) {
+    creator_free(scene->creators[i]);
+  }
+  for (size_t i = 0; i < scene->num_bodies; i++) {
+    body_handle_revoke(scene->bodies[i]);
+    body_free(scene->bodies[i]);
+  }
+  for (size_t i = 0; i < scene->num_body_creators; i++) {
+    free(scene->body_creators[i].creators);
+  }
+  free(scene->creators);
+  free(scene->bodies);
+  free(scene->filings);
+  free(scene->body_creators);
+  hash_map_free(scene->body_index);
+  if (scene->grid != NULL) {
+    spatial_hash_free(scene->grid);
+  }
+  if (scene->geometry != NULL) {
+    bvh_free(scene->geometry);
+  }
+  contact_table_free(scene->contacts);
+  body_store_free(scene->store);
+  free(scene);
+}
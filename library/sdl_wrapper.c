@@ -1,4 +1,5 @@
 #include "sdl_wrapper.h"
+#include "shape_view.h"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL2_gfxPrimitives.h>
 #include <SDL2/SDL_image.h>
@@ -56,6 +57,12 @@ uint32_t key_start_timestamp;
  */
 clock_t last_clock = 0;
 
+/**
+ * How far each body is drawn from its previous centroid towards its
+ * centroid, from 0 to 1.
+ */
+static double interpolation = 1;
+
 /** Computes the center of the window in pixel coordinates */
 vector_t get_window_center(void) {
   int *width = malloc(sizeof(*width)), *height = malloc(sizeof(*height));
@@ -189,36 +196,40 @@ void sdl_clear(void) {
   SDL_RenderClear(renderer);
 }
 
-SDL_Rect sdl_get_body_bounding_box(body_t *body) {
-  vector_t vert = {.x = __DBL_MAX__, .y = -__DBL_MAX__};
-  vector_t horiz = {.x = -__DBL_MAX__, .y = __DBL_MAX__};
-  list_t *points = body_get_shape(body);
-  size_t n = list_size(points);
-  vector_t window_center = get_window_center();
-  for (size_t i = 0; i < n; i++) {
-    vector_t *vertex = list_get(points, i);
-    vector_t pixel = get_window_position(*vertex, window_center);
-    if (pixel.y > vert.y) {
-      vert.y = pixel.y;
-    } else if (pixel.y < horiz.y) {
-      horiz.y = pixel.y;
-    }
+void sdl_set_interpolation(double alpha) { interpolation = alpha; }
 
-    if (pixel.x > horiz.x) {
-      horiz.x = pixel.x;
-    } else if (pixel.x < vert.x) {
-      vert.x = pixel.x;
-    }
-  }
+/** Gets how far from where it is a body should be drawn */
+vector_t get_render_offset(body_t *body) {
+  vector_t behind =
+      vec_subtract(body_get_previous_centroid(body), body_get_centroid(body));
+  return vec_multiply(1 - interpolation, behind);
+}
 
-  return (SDL_Rect){
-      .x = vert.x, .y = horiz.y, .w = horiz.x - vert.x, .h = vert.y - horiz.y};
+SDL_Rect sdl_get_body_bounding_box(body_t *body) {
+  vector_t min;
+  vector_t max;
+  shape_view_get_bounds(body, &min, &max);
+  vector_t offset = get_render_offset(body);
+  min = vec_add(min, offset);
+  max = vec_add(max, offset);
+  vector_t window_center = get_window_center();
+  // the window's y-axis points down, so the scene's top left corner is the
+  // rectangle's origin
+  vector_t top_left =
+      get_window_position((vector_t){.x = min.x, .y = max.y}, window_center);
+  vector_t bottom_right =
+      get_window_position((vector_t){.x = max.x, .y = min.y}, window_center);
+
+  return (SDL_Rect){.x = top_left.x,
+                    .y = top_left.y,
+                    .w = bottom_right.x - top_left.x,
+                    .h = bottom_right.y - top_left.y};
 }
 
 void sdl_draw_body(body_t *body) {
   // Check parameters
-  list_t *points = body_get_shape(body);
-  size_t n = list_size(points);
+  shape_view_t shape = shape_view_get(body);
+  size_t n = shape.size;
   assert(n >= 3);
   color_t color = body_get_color(body);
   double r = color.red;
@@ -230,6 +241,7 @@ void sdl_draw_body(body_t *body) {
   assert(0 <= b && b <= 1);
 
   vector_t window_center = get_window_center();
+  vector_t offset = get_render_offset(body);
 
   // Convert each vertex to a point on screen
   int16_t *x_points = malloc(sizeof(*x_points) * n),
@@ -237,8 +249,8 @@ void sdl_draw_body(body_t *body) {
   assert(x_points != NULL);
   assert(y_points != NULL);
   for (size_t i = 0; i < n; i++) {
-    vector_t *vertex = list_get(points, i);
-    vector_t pixel = get_window_position(*vertex, window_center);
+    vector_t pixel =
+        get_window_position(vec_add(shape.vertices[i], offset), window_center);
     x_points[i] = pixel.x;
     y_points[i] = pixel.y;
   }
@@ -249,7 +261,6 @@ void sdl_draw_body(body_t *body) {
   sdl_show();
   free(x_points);
   free(y_points);
-  list_free(points);
 }
 
 SDL_Texture *sdl_get_image_texture(const char *image_path) {
@@ -0,0 +1,286 @@
+#include "shape_view.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
+
+/**
+ * A body's shape, as of the version of the body it was copied at (see
+ * body_get_version()).
+ * The kind and bounds are found with each copy; the normals are derived from
+ * the vertices the first time they are asked for after it.
+ * A body with a shared local shape (see body_set_local_shape()) has its
+ * vertices placed from that shape instead of copied out of the body.
+ * A body declared an ellipse keeps that kind while it is unrotated.
+ */
+struct shape_cache {
+  uint64_t version;
+  double rotation;
+  vector_t *vertices;
+  double *x;
+  double *y;
+  size_t size;
+  size_t capacity;
+  vector_t *normals;
+  bool has_normals;
+  bool is_ellipse;
+  shape_kind_t kind;
+  vector_t min;
+  vector_t max;
+};
+
+void shape_cache_free(shape_cache_t *cache) {
+  free(cache->vertices);
+  free(cache->x);
+  free(cache->y);
+  free(cache->normals);
+  free(cache);
+}
+
+/**
+ * Makes room for a number of vertices in a cache's arrays, growing them if
+ * they are too small.
+ */
+static void reserve_vertices(shape_cache_t *cache, size_t size) {
+  if (size > cache->capacity) {
+    cache->vertices = realloc(cache->vertices, size * sizeof(vector_t));
+    cache->x = realloc(cache->x, size * sizeof(double));
+    cache->y = realloc(cache->y, size * sizeof(double));
+    cache->normals = realloc(cache->normals, size * sizeof(vector_t));
+    assert(cache->vertices && cache->x && cache->y && cache->normals);
+    cache->capacity = size;
+  }
+  cache->size = size;
+}
+
+/**
+ * Rotates local-space vertices about the origin and translates them to a
+ * centroid, several at a time where SIMD is available.
+ * The rotation's sine and cosine are computed once for all of the vertices.
+ *
+ * @param local_x the x-coordinates of the vertices relative to the centroid
+ * @param local_y the y-coordinates of the vertices relative to the centroid
+ * @param size the number of vertices
+ * @param centroid where to place the vertices
+ * @param rotation the angle to rotate the vertices by
+ * @param x filled with the x-coordinates of the placed vertices
+ * @param y filled with the y-coordinates of the placed vertices
+ */
+static void place_vertices(const double *local_x, const double *local_y,
+                           size_t size, vector_t centroid, double rotation,
+                           double *x, double *y) {
+  double cos_rotation = cos(rotation);
+  double sin_rotation = sin(rotation);
+  size_t i = 0;
+
+#if defined(__AVX__)
+  __m256d cos_r = _mm256_set1_pd(cos_rotation);
+  __m256d sin_r = _mm256_set1_pd(sin_rotation);
+  __m256d centroid_x = _mm256_set1_pd(centroid.x);
+  __m256d centroid_y = _mm256_set1_pd(centroid.y);
+  for (; i + 4 <= size; i += 4) {
+    __m256d lx = _mm256_loadu_pd(&local_x[i]);
+    __m256d ly = _mm256_loadu_pd(&local_y[i]);
+    __m256d rx = _mm256_sub_pd(_mm256_mul_pd(lx, cos_r),
+                               _mm256_mul_pd(ly, sin_r));
+    __m256d ry = _mm256_add_pd(_mm256_mul_pd(lx, sin_r),
+                               _mm256_mul_pd(ly, cos_r));
+    _mm256_storeu_pd(&x[i], _mm256_add_pd(centroid_x, rx));
+    _mm256_storeu_pd(&y[i], _mm256_add_pd(centroid_y, ry));
+  }
+#elif defined(__SSE2__)
+  __m128d cos_r = _mm_set1_pd(cos_rotation);
+  __m128d sin_r = _mm_set1_pd(sin_rotation);
+  __m128d centroid_x = _mm_set1_pd(centroid.x);
+  __m128d centroid_y = _mm_set1_pd(centroid.y);
+  for (; i + 2 <= size; i += 2) {
+    __m128d lx = _mm_loadu_pd(&local_x[i]);
+    __m128d ly = _mm_loadu_pd(&local_y[i]);
+    __m128d rx = _mm_sub_pd(_mm_mul_pd(lx, cos_r), _mm_mul_pd(ly, sin_r));
+    __m128d ry = _mm_add_pd(_mm_mul_pd(lx, sin_r), _mm_mul_pd(ly, cos_r));
+    _mm_storeu_pd(&x[i], _mm_add_pd(centroid_x, rx));
+    _mm_storeu_pd(&y[i], _mm_add_pd(centroid_y, ry));
+  }
+#elif defined(__wasm_simd128__)
+  v128_t cos_r = wasm_f64x2_splat(cos_rotation);
+  v128_t sin_r = wasm_f64x2_splat(sin_rotation);
+  v128_t centroid_x = wasm_f64x2_splat(centroid.x);
+  v128_t centroid_y = wasm_f64x2_splat(centroid.y);
+  for (; i + 2 <= size; i += 2) {
+    v128_t lx = wasm_v128_load(&local_x[i]);
+    v128_t ly = wasm_v128_load(&local_y[i]);
+    v128_t rx = wasm_f64x2_sub(wasm_f64x2_mul(lx, cos_r),
+                               wasm_f64x2_mul(ly, sin_r));
+    v128_t ry = wasm_f64x2_add(wasm_f64x2_mul(lx, sin_r),
+                               wasm_f64x2_mul(ly, cos_r));
+    wasm_v128_store(&x[i], wasm_f64x2_add(centroid_x, rx));
+    wasm_v128_store(&y[i], wasm_f64x2_add(centroid_y, ry));
+  }
+#endif
+
+  for (; i < size; i++) {
+    x[i] = centroid.x + (local_x[i] * cos_rotation - local_y[i] * sin_rotation);
+    y[i] = centroid.y + (local_x[i] * sin_rotation + local_y[i] * cos_rotation);
+  }
+}
+
+/**
+ * Returns whether a polygon is a box whose edges are all axis-aligned.
+ *
+ * @param vertices the vertices of the shape
+ * @param size the number of vertices in the shape
+ * @return whether the shape is an axis-aligned box
+ */
+static bool is_aabb(const vector_t *vertices, size_t size) {
+  if (size != 4) {
+    return false;
+  }
+  bool prev_horizontal = false;
+  for (size_t i = 0; i < size; i++) {
+    vector_t edge = vec_subtract(vertices[i], vertices[(i + 1) % size]);
+    bool horizontal = edge.y == 0 && edge.x != 0;
+    bool vertical = edge.x == 0 && edge.y != 0;
+    // consecutive edges must alternate between horizontal and vertical
+    if (!(horizontal || vertical) || (i > 0 && horizontal == prev_horizontal)) {
+      return false;
+    }
+    prev_horizontal = horizontal;
+  }
+  return true;
+}
+
+/**
+ * Finds the bounds and kind of a cache's freshly placed vertices.
+ */
+static void classify_cache(shape_cache_t *cache) {
+  cache->min = cache->vertices[0];
+  cache->max = cache->vertices[0];
+  for (size_t i = 1; i < cache->size; i++) {
+    cache->min.x = fmin(cache->min.x, cache->vertices[i].x);
+    cache->min.y = fmin(cache->min.y, cache->vertices[i].y);
+    cache->max.x = fmax(cache->max.x, cache->vertices[i].x);
+    cache->max.y = fmax(cache->max.y, cache->vertices[i].y);
+  }
+  if (cache->is_ellipse && cache->rotation == 0) {
+    cache->kind = SHAPE_ELLIPSE;
+  } else if (is_aabb(cache->vertices, cache->size)) {
+    cache->kind = SHAPE_AABB;
+  } else {
+    cache->kind = SHAPE_POLYGON;
+  }
+}
+
+/**
+ * Brings a body's cache up to date with the body's current transform, by
+ * placing its shared local shape, or else the body's own local vertices,
+ * there.
+ */
+static void refresh_cache(body_t *body, shape_cache_t *cache) {
+  vector_t centroid = body_get_centroid(body);
+  cache->version = body_get_version(body);
+  cache->rotation = body_get_rotation(body);
+  cache->has_normals = false;
+
+  local_shape_t *shape = body_get_local_shape(body);
+  if (shape != NULL) {
+    const double *local_x = local_shape_x(shape);
+    const double *local_y = local_shape_y(shape);
+    reserve_vertices(cache, local_shape_size(shape));
+    if (cache->rotation == 0) {
+      for (size_t i = 0; i < cache->size; i++) {
+        cache->x[i] = centroid.x + local_x[i];
+        cache->y[i] = centroid.y + local_y[i];
+      }
+    } else {
+      place_vertices(local_x, local_y, cache->size, centroid,
+                     cache->rotation, cache->x, cache->y);
+    }
+    for (size_t i = 0; i < cache->size; i++) {
+      cache->vertices[i] = (vector_t){.x = cache->x[i], .y = cache->y[i]};
+    }
+    classify_cache(cache);
+    return;
+  }
+
+  size_t size;
+  const vector_t *local = body_get_local_vertices(body, &size);
+  reserve_vertices(cache, size);
+  for (size_t i = 0; i < cache->size; i++) {
+    // the same arithmetic as body_get_shape(), without copying into a list
+    cache->vertices[i] =
+        vec_add(centroid, vec_rotate(local[i], cache->rotation));
+    cache->x[i] = cache->vertices[i].x;
+    cache->y[i] = cache->vertices[i].y;
+  }
+  classify_cache(cache);
+}
+
+/**
+ * Returns a body's cache, creating it if the body has none yet and
+ * refreshing it if the body has moved or turned since it was last copied.
+ */
+static shape_cache_t *get_cache(body_t *body) {
+  shape_cache_t *cache = body_get_shape_cache(body);
+  if (cache == NULL) {
+    cache = calloc(1, sizeof(shape_cache_t));
+    assert(cache);
+    refresh_cache(body, cache);
+    body_set_shape_cache(body, cache);
+  } else if (cache->version != body_get_version(body)) {
+    refresh_cache(body, cache);
+  }
+  return cache;
+}
+
+shape_view_t shape_view_get(body_t *body) {
+  shape_cache_t *cache = get_cache(body);
+  return (shape_view_t){.vertices = cache->vertices,
+                        .x = cache->x,
+                        .y = cache->y,
+                        .size = cache->size,
+                        .kind = cache->kind,
+                        .min = cache->min,
+                        .max = cache->max};
+}
+
+const vector_t *shape_view_get_normals(body_t *body) {
+  shape_cache_t *cache = get_cache(body);
+  local_shape_t *shape = body_get_local_shape(body);
+  if (shape != NULL && cache->rotation == 0) {
+    // translating a shape does not change its normals
+    return local_shape_normals(shape);
+  }
+  if (!cache->has_normals) {
+    for (size_t i = 0; i < cache->size; i++) {
+      // the same arithmetic as the collision tests' own edge normals
+      vector_t edge = vec_subtract(cache->vertices[i],
+                                   cache->vertices[(i + 1) % cache->size]);
+      vector_t axis = {.x = -edge.y, .y = edge.x};
+      cache->normals[i] = vec_multiply(1 / vec_get_length(axis), axis);
+    }
+    cache->has_normals = true;
+  }
+  return cache->normals;
+}
+
+void shape_view_get_bounds(body_t *body, vector_t *min, vector_t *max) {
+  shape_cache_t *cache = get_cache(body);
+  *min = cache->min;
+  *max = cache->max;
+}
+
+void shape_view_set_ellipse(body_t *body) {
+  shape_cache_t *cache = get_cache(body);
+  cache->is_ellipse = true;
+  classify_cache(cache);
+}
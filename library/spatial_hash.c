@@ -0,0 +1,339 @@
+#include "spatial_hash.h"
+#include "collision.h"
+#include "hash_map.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/** Number of buckets grid cells are hashed into; must be a power of two */
+static const size_t NUM_BUCKETS = 4096;
+/** Initial capacity of each bucket, and of the proxy arrays */
+static const size_t INIT_BUCKET_CAPACITY = 4;
+static const size_t INIT_PROXY_CAPACITY = 32;
+
+/**
+ * The range of grid cells a proxy was last inserted into.
+ */
+typedef struct {
+  long min_x;
+  long min_y;
+  long max_x;
+  long max_y;
+} cell_range_t;
+
+/**
+ * The numbers of the proxies of every body covering a cell that hashes to
+ * this bucket.
+ */
+typedef struct {
+  size_t *proxies;
+  size_t size;
+  size_t capacity;
+} bucket_t;
+
+/**
+ * Each tracked body has a proxy, identified by its index into the parallel
+ * proxy arrays. The arrays stay dense: removing a proxy moves the last one
+ * into its place, so a query reads the fields it tests from contiguous
+ * memory instead of following a pointer per body.
+ */
+struct spatial_hash {
+  double cell_size;
+  bucket_t *buckets;
+
+  body_t **bodies;
+  collision_filter_t *filters;
+  /** The bounds each body was last inserted with */
+  double *min_x;
+  double *min_y;
+  double *max_x;
+  double *max_y;
+  cell_range_t *cells;
+  /** The last query that reported each body, to report it only once */
+  size_t *query_stamps;
+  size_t num_proxies;
+  size_t proxy_capacity;
+
+  /** Map from body to proxy */
+  hash_map_t *index;
+  size_t query_stamp;
+};
+
+/**
+ * Returns the grid coordinate of the cell containing a coordinate.
+ *
+ * @param hash the spatial hash
+ * @param coord an x or y coordinate
+ * @return the index of the cell along that axis
+ */
+static long get_cell(spatial_hash_t *hash, double coord) {
+  return (long)floor(coord / hash->cell_size);
+}
+
+/**
+ * Returns the bucket that a grid cell hashes to.
+ *
+ * @param hash the spatial hash
+ * @param cell_x the cell's x index
+ * @param cell_y the cell's y index
+ * @return the cell's bucket
+ */
+static bucket_t *get_bucket(spatial_hash_t *hash, long cell_x, long cell_y) {
+  size_t key = ((size_t)cell_x * 73856093u) ^ ((size_t)cell_y * 19349663u);
+  return &hash->buckets[key & (NUM_BUCKETS - 1)];
+}
+
+/**
+ * Appends a proxy to a bucket, growing it if it is full.
+ */
+static void bucket_add(bucket_t *bucket, size_t proxy) {
+  if (bucket->size == bucket->capacity) {
+    bucket->capacity =
+        bucket->capacity ? bucket->capacity * 2 : INIT_BUCKET_CAPACITY;
+    bucket->proxies =
+        realloc(bucket->proxies, bucket->capacity * sizeof(size_t));
+    assert(bucket->proxies);
+  }
+  bucket->proxies[bucket->size++] = proxy;
+}
+
+/**
+ * Removes one occurrence of a proxy from a bucket, if present.
+ */
+static void bucket_remove(bucket_t *bucket, size_t proxy) {
+  for (size_t i = 0; i < bucket->size; i++) {
+    if (bucket->proxies[i] == proxy) {
+      // order within a bucket does not matter, so swap in the last proxy
+      bucket->proxies[i] = bucket->proxies[--bucket->size];
+      return;
+    }
+  }
+}
+
+/**
+ * Renumbers one occurrence of a proxy in a bucket, if present.
+ */
+static void bucket_renumber(bucket_t *bucket, size_t from, size_t to) {
+  for (size_t i = 0; i < bucket->size; i++) {
+    if (bucket->proxies[i] == from) {
+      bucket->proxies[i] = to;
+      return;
+    }
+  }
+}
+
+/**
+ * Inserts a proxy into the buckets of every cell in its stored cell range.
+ * A cell range that wraps onto the same bucket twice inserts it twice;
+ * queries skip the duplicate using the query stamp.
+ */
+static void insert_cells(spatial_hash_t *hash, size_t proxy) {
+  cell_range_t cells = hash->cells[proxy];
+  for (long x = cells.min_x; x <= cells.max_x; x++) {
+    for (long y = cells.min_y; y <= cells.max_y; y++) {
+      bucket_add(get_bucket(hash, x, y), proxy);
+    }
+  }
+}
+
+/**
+ * Removes a proxy from the buckets of every cell in its stored cell range.
+ */
+static void remove_cells(spatial_hash_t *hash, size_t proxy) {
+  cell_range_t cells = hash->cells[proxy];
+  for (long x = cells.min_x; x <= cells.max_x; x++) {
+    for (long y = cells.min_y; y <= cells.max_y; y++) {
+      bucket_remove(get_bucket(hash, x, y), proxy);
+    }
+  }
+}
+
+/**
+ * Returns the proxy number of a tracked body, asserting that it is tracked.
+ */
+static size_t get_proxy(spatial_hash_t *hash, body_t *body) {
+  size_t proxy = hash_map_get(hash->index, (uintptr_t)body);
+  assert(proxy != HASH_MAP_NONE);
+  return proxy;
+}
+
+/**
+ * Grows the proxy arrays to the given capacity.
+ */
+static void reserve_proxies(spatial_hash_t *hash, size_t capacity) {
+  hash->bodies = realloc(hash->bodies, capacity * sizeof(body_t *));
+  hash->filters =
+      realloc(hash->filters, capacity * sizeof(collision_filter_t));
+  hash->min_x = realloc(hash->min_x, capacity * sizeof(double));
+  hash->min_y = realloc(hash->min_y, capacity * sizeof(double));
+  hash->max_x = realloc(hash->max_x, capacity * sizeof(double));
+  hash->max_y = realloc(hash->max_y, capacity * sizeof(double));
+  hash->cells = realloc(hash->cells, capacity * sizeof(cell_range_t));
+  hash->query_stamps =
+      realloc(hash->query_stamps, capacity * sizeof(size_t));
+  assert(hash->bodies && hash->filters && hash->min_x && hash->min_y &&
+         hash->max_x && hash->max_y && hash->cells && hash->query_stamps);
+  hash->proxy_capacity = capacity;
+}
+
+/**
+ * Recomputes a proxy's bounds from its body, and returns the cells they
+ * cover.
+ */
+static cell_range_t refresh_bounds(spatial_hash_t *hash, size_t proxy) {
+  vector_t min;
+  vector_t max;
+  find_bounding_box(hash->bodies[proxy], &min, &max);
+  hash->min_x[proxy] = min.x;
+  hash->min_y[proxy] = min.y;
+  hash->max_x[proxy] = max.x;
+  hash->max_y[proxy] = max.y;
+  return (cell_range_t){.min_x = get_cell(hash, min.x),
+                        .min_y = get_cell(hash, min.y),
+                        .max_x = get_cell(hash, max.x),
+                        .max_y = get_cell(hash, max.y)};
+}
+
+spatial_hash_t *spatial_hash_init(double cell_size) {
+  assert(cell_size > 0);
+  spatial_hash_t *hash = malloc(sizeof(spatial_hash_t));
+  assert(hash);
+  hash->cell_size = cell_size;
+  hash->buckets = calloc(NUM_BUCKETS, sizeof(bucket_t));
+  assert(hash->buckets);
+  hash->bodies = NULL;
+  hash->filters = NULL;
+  hash->min_x = NULL;
+  hash->min_y = NULL;
+  hash->max_x = NULL;
+  hash->max_y = NULL;
+  hash->cells = NULL;
+  hash->query_stamps = NULL;
+  hash->num_proxies = 0;
+  reserve_proxies(hash, INIT_PROXY_CAPACITY);
+  hash->index = hash_map_init(INIT_PROXY_CAPACITY);
+  hash->query_stamp = 0;
+  return hash;
+}
+
+void spatial_hash_add(spatial_hash_t *hash, body_t *body,
+                      collision_filter_t filter) {
+  assert(hash_map_get(hash->index, (uintptr_t)body) == HASH_MAP_NONE);
+  if (hash->num_proxies == hash->proxy_capacity) {
+    reserve_proxies(hash, hash->proxy_capacity * 2);
+  }
+
+  size_t proxy = hash->num_proxies++;
+  hash->bodies[proxy] = body;
+  hash->filters[proxy] = filter;
+  hash->query_stamps[proxy] = hash->query_stamp;
+  hash->cells[proxy] = refresh_bounds(hash, proxy);
+  insert_cells(hash, proxy);
+  hash_map_put(hash->index, (uintptr_t)body, proxy);
+}
+
+void spatial_hash_update(spatial_hash_t *hash, body_t *body) {
+  size_t proxy = get_proxy(hash, body);
+  cell_range_t cells = refresh_bounds(hash, proxy);
+  cell_range_t old_cells = hash->cells[proxy];
+  if (cells.min_x != old_cells.min_x || cells.min_y != old_cells.min_y ||
+      cells.max_x != old_cells.max_x || cells.max_y != old_cells.max_y) {
+    remove_cells(hash, proxy);
+    hash->cells[proxy] = cells;
+    insert_cells(hash, proxy);
+  }
+}
+
+void spatial_hash_remove(spatial_hash_t *hash, body_t *body) {
+  size_t proxy = hash_map_remove(hash->index, (uintptr_t)body);
+  if (proxy == HASH_MAP_NONE) {
+    return;
+  }
+  remove_cells(hash, proxy);
+
+  // keep the arrays dense by moving the last proxy into the freed place
+  size_t last = --hash->num_proxies;
+  if (proxy != last) {
+    cell_range_t cells = hash->cells[last];
+    for (long x = cells.min_x; x <= cells.max_x; x++) {
+      for (long y = cells.min_y; y <= cells.max_y; y++) {
+        bucket_renumber(get_bucket(hash, x, y), last, proxy);
+      }
+    }
+    hash->bodies[proxy] = hash->bodies[last];
+    hash->filters[proxy] = hash->filters[last];
+    hash->min_x[proxy] = hash->min_x[last];
+    hash->min_y[proxy] = hash->min_y[last];
+    hash->max_x[proxy] = hash->max_x[last];
+    hash->max_y[proxy] = hash->max_y[last];
+    hash->cells[proxy] = cells;
+    hash->query_stamps[proxy] = hash->query_stamps[last];
+    hash_map_put(hash->index, (uintptr_t)hash->bodies[proxy], proxy);
+  }
+}
+
+/**
+ * Adds every proxy overlapping a region whose filter allows it to collide with
+ * the query's to a list of bodies, skipping one body and any proxy already
+ * reported by this query.
+ */
+static list_t *query(spatial_hash_t *hash, vector_t min, vector_t max,
+                     collision_filter_t filter, body_t *skip) {
+  list_t *bodies = list_init(INIT_BUCKET_CAPACITY, NULL);
+  size_t stamp = ++hash->query_stamp;
+  long max_cell_x = get_cell(hash, max.x);
+  long max_cell_y = get_cell(hash, max.y);
+
+  for (long x = get_cell(hash, min.x); x <= max_cell_x; x++) {
+    for (long y = get_cell(hash, min.y); y <= max_cell_y; y++) {
+      bucket_t *bucket = get_bucket(hash, x, y);
+      for (size_t i = 0; i < bucket->size; i++) {
+        size_t proxy = bucket->proxies[i];
+        if (hash->query_stamps[proxy] == stamp ||
+            hash->bodies[proxy] == skip ||
+            !can_collide(hash->filters[proxy], filter)) {
+          continue;
+        }
+        hash->query_stamps[proxy] = stamp;
+        if (hash->min_x[proxy] <= max.x && min.x <= hash->max_x[proxy] &&
+            hash->min_y[proxy] <= max.y && min.y <= hash->max_y[proxy]) {
+          list_add(bodies, hash->bodies[proxy]);
+        }
+      }
+    }
+  }
+  return bodies;
+}
+
+list_t *spatial_hash_query(spatial_hash_t *hash, vector_t min, vector_t max,
+                           collision_filter_t filter) {
+  return query(hash, min, max, filter, NULL);
+}
+
+list_t *spatial_hash_query_body(spatial_hash_t *hash, body_t *body,
+                                collision_filter_t filter) {
+  size_t proxy = get_proxy(hash, body);
+  vector_t min = {.x = hash->min_x[proxy], .y = hash->min_y[proxy]};
+  vector_t max = {.x = hash->max_x[proxy], .y = hash->max_y[proxy]};
+  return query(hash, min, max, filter, body);
+}
+
+void spatial_hash_free(spatial_hash_t *hash) {
+  for (size_t i = 0; i < NUM_BUCKETS; i++) {
+    free(hash->buckets[i].proxies);
+  }
+  free(hash->buckets);
+  free(hash->bodies);
+  free(hash->filters);
+  free(hash->min_x);
+  free(hash->min_y);
+  free(hash->max_x);
+  free(hash->max_y);
+  free(hash->cells);
+  free(hash->query_stamps);
+  hash_map_free(hash->index);
+  free(hash);
+}
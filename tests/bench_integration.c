@@ -0,0 +1,161 @@
+#include "scene.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * Times integrating 100k moving bodies, one body_tick() call at a time and in
+ * one body_store_tick() pass, with and without as many still bodies in the
+ * same store, and checks that every run leaves the bodies in the same place.
+ * Also times scene_tick(), which integrates through body_store_tick().
+ * Build it without ASan for meaningful times: make NO_ASAN=true bench
+ */
+
+const color_t BLACK = {0, 0, 0};
+const size_t NUM_BODIES = 100000;
+const size_t NUM_TICKS = 100;
+const double DT = 1.0 / 60;
+
+double random_between(double min, double max) {
+  return min + (max - min) * rand() / RAND_MAX;
+}
+
+body_t *make_box(double mass) {
+  list_t *shape = list_init(4, free);
+  vector_t corners[] = {{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+  for (size_t i = 0; i < 4; i++) {
+    vector_t *vertex = malloc(sizeof(vector_t));
+    assert(vertex);
+    *vertex = corners[i];
+    list_add(shape, vertex);
+  }
+  body_t *body = body_init(shape, mass, BLACK);
+  vector_t centroid = {random_between(0, 1e3), random_between(0, 1e3)};
+  vector_t velocity = {random_between(-10, 10), random_between(-10, 10)};
+  body_set_centroid(body, centroid);
+  body_set_velocity(body, velocity);
+  return body;
+}
+
+/**
+ * Adds forces and impulses to the moving bodies, the same for every run.
+ */
+void push_bodies(body_t **bodies, size_t tick) {
+  for (size_t i = 0; i < NUM_BODIES; i++) {
+    body_add_force(bodies[i], (vector_t){(double)(i % 7), -9.8});
+    if ((i + tick) % 16 == 0) {
+      body_add_impulse(bodies[i], (vector_t){0.5, 1});
+    }
+  }
+}
+
+/**
+ * Fills a store with NUM_BODIES moving bodies, followed by num_still bodies
+ * with infinite mass and no velocity.
+ *
+ * @param bodies filled with the moving bodies, then the still ones
+ */
+body_store_t *make_store(body_t **bodies, size_t num_still) {
+  srand(1);
+  body_store_t *store = body_store_init(NUM_BODIES + num_still);
+  for (size_t i = 0; i < NUM_BODIES + num_still; i++) {
+    bodies[i] = make_box(i < NUM_BODIES ? random_between(1, 10) : INFINITY);
+    if (i >= NUM_BODIES) {
+      body_set_velocity(bodies[i], VEC_ZERO);
+    }
+    body_store_add(store, bodies[i]);
+  }
+  return store;
+}
+
+void free_store(body_store_t *store, body_t **bodies, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    body_free(bodies[i]);
+  }
+  body_store_free(store);
+  free(bodies);
+}
+
+/**
+ * Ticks the bodies in a store, either in one body_store_tick() pass or one
+ * body_tick() call at a time.
+ *
+ * @return the time spent integrating per tick, in milliseconds
+ */
+double time_ticks(body_store_t *store, body_t **bodies, bool batched) {
+  double seconds = 0;
+  for (size_t tick = 0; tick < NUM_TICKS; tick++) {
+    push_bodies(bodies, tick);
+    clock_t start = clock();
+    if (batched) {
+      body_store_tick(store, DT);
+    } else {
+      for (size_t i = 0; i < NUM_BODIES; i++) {
+        body_tick(bodies[i], DT);
+      }
+    }
+    seconds += (double)(clock() - start) / CLOCKS_PER_SEC;
+  }
+  return seconds * 1e3 / NUM_TICKS;
+}
+
+/**
+ * Ticks a scene of NUM_BODIES moving bodies through scene_tick().
+ *
+ * @return the time per tick, in milliseconds
+ */
+double time_scene_ticks() {
+  srand(1);
+  scene_t *scene = scene_init();
+  body_t **bodies = malloc(NUM_BODIES * sizeof(body_t *));
+  assert(bodies);
+  for (size_t i = 0; i < NUM_BODIES; i++) {
+    bodies[i] = make_box(random_between(1, 10));
+    scene_add_body(scene, bodies[i]);
+  }
+  double seconds = 0;
+  for (size_t tick = 0; tick < NUM_TICKS; tick++) {
+    push_bodies(bodies, tick);
+    clock_t start = clock();
+    scene_tick(scene, DT);
+    seconds += (double)(clock() - start) / CLOCKS_PER_SEC;
+  }
+  scene_free(scene);
+  free(bodies);
+  return seconds * 1e3 / NUM_TICKS;
+}
+
+int main() {
+  body_t **bodies1 = malloc(NUM_BODIES * sizeof(body_t *));
+  body_t **bodies2 = malloc(NUM_BODIES * sizeof(body_t *));
+  body_t **bodies3 = malloc(2 * NUM_BODIES * sizeof(body_t *));
+  assert(bodies1 && bodies2 && bodies3);
+  body_store_t *store1 = make_store(bodies1, 0);
+  body_store_t *store2 = make_store(bodies2, 0);
+  body_store_t *store3 = make_store(bodies3, NUM_BODIES);
+  double one_by_one_time = time_ticks(store1, bodies1, false);
+  double batched_time = time_ticks(store2, bodies2, true);
+  double with_still_time = time_ticks(store3, bodies3, true);
+  for (size_t i = 0; i < NUM_BODIES; i++) {
+    vector_t centroid1 = body_get_centroid(bodies1[i]);
+    vector_t centroid2 = body_get_centroid(bodies2[i]);
+    vector_t centroid3 = body_get_centroid(bodies3[i]);
+    assert(centroid1.x == centroid2.x && centroid1.y == centroid2.y);
+    assert(centroid1.x == centroid3.x && centroid1.y == centroid3.y);
+  }
+  free_store(store1, bodies1, NUM_BODIES);
+  free_store(store2, bodies2, NUM_BODIES);
+  free_store(store3, bodies3, 2 * NUM_BODIES);
+  double scene_time = time_scene_ticks();
+
+  printf("%zu moving bodies, ms per tick:\n", NUM_BODIES);
+  printf("  body_tick one at a time:                 %7.3f\n",
+         one_by_one_time);
+  printf("  body_store_tick:                         %7.3f\n", batched_time);
+  printf("  body_store_tick, plus %zu still bodies: %7.3f\n", NUM_BODIES,
+         with_still_time);
+  printf("  scene_tick:                              %7.3f\n", scene_time);
+}
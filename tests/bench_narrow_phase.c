@@ -0,0 +1,169 @@
+#include "collision.h"
+#include "shape_view.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * Times find_collision_using() with the separating axis test and with GJK on
+ * pairs of regular polygons, as their number of vertices grows.
+ * Then times the game's player, a 20-vertex circle, against boxes the size
+ * of the level's bricks, tested as an exact ellipse and as a polygon.
+ * Build it without ASan for meaningful times: make NO_ASAN=true bench
+ */
+
+const color_t BLACK = {0, 0, 0};
+const size_t VERTEX_COUNTS[] = {4, 8, 16, 20, 32, 64, 128, 256};
+const size_t NUM_PAIRS = 256;
+const size_t NUM_ROUNDS = 40;
+const size_t SPIRIT_NUM_POINTS = 20;
+const double SPIRIT_RADIUS = 15;
+
+body_t *make_polygon(vector_t center, double radius, size_t size,
+                     double offset) {
+  list_t *shape = list_init(size, free);
+  for (size_t i = 0; i < size; i++) {
+    double angle = 2 * M_PI * (i + offset) / size;
+    vector_t *vertex = malloc(sizeof(vector_t));
+    assert(vertex);
+    *vertex = (vector_t){center.x + radius * cos(angle),
+                         center.y + radius * sin(angle)};
+    list_add(shape, vertex);
+  }
+  return body_init(shape, 1, BLACK);
+}
+
+body_t *make_regular_polygon(vector_t center, double radius, size_t size) {
+  // offset by half a step so no edge is axis-aligned
+  return make_polygon(center, radius, size, 0.5);
+}
+
+double random_between(double min, double max) {
+  return min + (max - min) * rand() / RAND_MAX;
+}
+
+body_t *make_box(vector_t center, double w, double h) {
+  list_t *shape = list_init(4, free);
+  vector_t corners[] = {{-w / 2, -h / 2}, {w / 2, -h / 2}, {w / 2, h / 2},
+                        {-w / 2, h / 2}};
+  for (size_t i = 0; i < 4; i++) {
+    vector_t *vertex = malloc(sizeof(vector_t));
+    assert(vertex);
+    *vertex = vec_add(center, corners[i]);
+    list_add(shape, vertex);
+  }
+  return body_init(shape, INFINITY, BLACK);
+}
+
+/**
+ * Tests one body against each of a number of others, several times over.
+ *
+ * @return the average time per test, in nanoseconds
+ */
+double time_against(body_t *body, body_t **others, size_t *num_collided) {
+  *num_collided = 0;
+  clock_t start = clock();
+  for (size_t round = 0; round < NUM_ROUNDS; round++) {
+    for (size_t i = 0; i < NUM_PAIRS; i++) {
+      *num_collided += find_collision(body, others[i]).collided;
+    }
+  }
+  double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+  return seconds * 1e9 / (NUM_ROUNDS * NUM_PAIRS);
+}
+
+/**
+ * Times the player's circle against brick-sized boxes around it, about half
+ * of which touch it, once declared an ellipse and once as a plain polygon.
+ */
+void time_spirit() {
+  body_t *ellipse = make_polygon(VEC_ZERO, SPIRIT_RADIUS, SPIRIT_NUM_POINTS, 0);
+  body_t *polygon = make_polygon(VEC_ZERO, SPIRIT_RADIUS, SPIRIT_NUM_POINTS, 0);
+  shape_view_set_ellipse(ellipse);
+  body_t *boxes[NUM_PAIRS];
+  for (size_t i = 0; i < NUM_PAIRS; i++) {
+    vector_t center = {random_between(-60, 60), random_between(-40, 40)};
+    boxes[i] =
+        make_box(center, random_between(20, 80), random_between(10, 30));
+  }
+
+  size_t ellipse_collided;
+  size_t polygon_collided;
+  double ellipse_time = time_against(ellipse, boxes, &ellipse_collided);
+  double polygon_time = time_against(polygon, boxes, &polygon_collided);
+  printf("\n%zu-vertex player against %zu boxes, ns/test:\n",
+         SPIRIT_NUM_POINTS, NUM_PAIRS);
+  printf("  as an ellipse: %7.1f (%zu collided)\n", ellipse_time,
+         ellipse_collided / NUM_ROUNDS);
+  printf("  as a polygon:  %7.1f (%zu collided)\n", polygon_time,
+         polygon_collided / NUM_ROUNDS);
+
+  body_free(ellipse);
+  body_free(polygon);
+  for (size_t i = 0; i < NUM_PAIRS; i++) {
+    body_free(boxes[i]);
+  }
+}
+
+/**
+ * Tests every pair with one narrow phase, several times over.
+ *
+ * @return the average time per test, in nanoseconds
+ */
+double time_narrow_phase(body_t **bodies1, body_t **bodies2,
+                         narrow_phase_t narrow_phase, size_t *num_collided) {
+  *num_collided = 0;
+  clock_t start = clock();
+  for (size_t round = 0; round < NUM_ROUNDS; round++) {
+    for (size_t i = 0; i < NUM_PAIRS; i++) {
+      *num_collided +=
+          find_collision_using(bodies1[i], bodies2[i], narrow_phase).collided;
+    }
+  }
+  double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+  return seconds * 1e9 / (NUM_ROUNDS * NUM_PAIRS);
+}
+
+int main() {
+  srand(1);
+  printf("%8s %12s %12s %10s\n", "vertices", "SAT ns/test", "GJK ns/test",
+         "agree");
+  for (size_t k = 0; k < sizeof(VERTEX_COUNTS) / sizeof(size_t); k++) {
+    size_t size = VERTEX_COUNTS[k];
+    body_t *bodies1[NUM_PAIRS];
+    body_t *bodies2[NUM_PAIRS];
+    for (size_t i = 0; i < NUM_PAIRS; i++) {
+      bodies1[i] = make_regular_polygon(VEC_ZERO, 1, size);
+      // about half of the pairs overlap
+      vector_t offset = {random_between(-2.2, 2.2), random_between(-2.2, 2.2)};
+      bodies2[i] = make_regular_polygon(offset, random_between(0.5, 1), size);
+      body_set_rotation(bodies2[i], random_between(0, M_PI));
+    }
+
+    size_t agree = 0;
+    for (size_t i = 0; i < NUM_PAIRS; i++) {
+      agree += find_collision_using(bodies1[i], bodies2[i], NARROW_PHASE_SAT)
+                   .collided ==
+               find_collision_using(bodies1[i], bodies2[i], NARROW_PHASE_GJK)
+                   .collided;
+    }
+
+    size_t sat_collided;
+    size_t gjk_collided;
+    double sat_time =
+        time_narrow_phase(bodies1, bodies2, NARROW_PHASE_SAT, &sat_collided);
+    double gjk_time =
+        time_narrow_phase(bodies1, bodies2, NARROW_PHASE_GJK, &gjk_collided);
+    printf("%8zu %12.1f %12.1f %6zu/%zu\n", size, sat_time, gjk_time, agree,
+           NUM_PAIRS);
+
+    for (size_t i = 0; i < NUM_PAIRS; i++) {
+      body_free(bodies1[i]);
+      body_free(bodies2[i]);
+    }
+  }
+  time_spirit();
+}
@@ -0,0 +1,100 @@
+#include "scene.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * Times scene_tick() on a level-sized scene: one player body with a force
+ * creator pairing it with each of 50k other bodies, the way the game wires
+ * one collision per brick, gem and door. One run picks up a few bodies every
+ * tick, the other picks up none, so the difference is the cost of removing
+ * the picked up bodies and their force creators.
+ * Build it without ASan for meaningful times: make NO_ASAN=true bench
+ */
+
+const color_t BLACK = {0, 0, 0};
+const size_t NUM_CREATORS = 50000;
+const size_t NUM_TICKS = 500;
+const size_t PICKUPS_PER_TICK = 10;
+const double DT = 1.0 / 60;
+
+body_t *make_box(vector_t center) {
+  list_t *shape = list_init(4, free);
+  vector_t corners[] = {{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+  for (size_t i = 0; i < 4; i++) {
+    vector_t *vertex = malloc(sizeof(vector_t));
+    assert(vertex);
+    *vertex = vec_add(center, corners[i]);
+    list_add(shape, vertex);
+  }
+  return body_init(shape, 1, BLACK);
+}
+
+/**
+ * Stands in for a collision handler; counts the pairs it is called on.
+ */
+void count_pair(void *aux, list_t *bodies) { (*(size_t *)aux)++; }
+
+/**
+ * Ticks the scene, removing pickups_per_tick of the other bodies each tick,
+ * spread across the scene.
+ *
+ * @param num_calls set to the number of force creator calls made
+ * @return the time per tick, in milliseconds
+ */
+double time_ticks(size_t pickups_per_tick, size_t *num_calls) {
+  scene_t *scene = scene_init();
+  body_t *player = make_box(VEC_ZERO);
+  scene_add_body(scene, player);
+  body_t **others = malloc(NUM_CREATORS * sizeof(body_t *));
+  assert(others);
+  *num_calls = 0;
+  for (size_t i = 0; i < NUM_CREATORS; i++) {
+    others[i] = make_box((vector_t){i % 1000, i / 1000});
+    scene_add_body(scene, others[i]);
+    list_t *bodies = list_init(2, NULL);
+    list_add(bodies, player);
+    list_add(bodies, others[i]);
+    scene_add_force_creator(scene, count_pair, num_calls, bodies, NULL);
+  }
+
+  // a stride coprime to the number of bodies visits each of them once
+  const size_t stride = 7919;
+  size_t next_pickup = 0;
+  double seconds = 0;
+  for (size_t tick = 0; tick < NUM_TICKS; tick++) {
+    for (size_t i = 0; i < pickups_per_tick; i++) {
+      body_remove(others[next_pickup]);
+      next_pickup = (next_pickup + stride) % NUM_CREATORS;
+    }
+    clock_t start = clock();
+    scene_tick(scene, DT);
+    seconds += (double)(clock() - start) / CLOCKS_PER_SEC;
+  }
+  assert(scene_bodies(scene) ==
+         1 + NUM_CREATORS - pickups_per_tick * NUM_TICKS);
+
+  scene_free(scene);
+  free(others);
+  return seconds * 1e3 / NUM_TICKS;
+}
+
+int main() {
+  size_t idle_calls;
+  size_t pickup_calls;
+  double idle_time = time_ticks(0, &idle_calls);
+  double pickup_time = time_ticks(PICKUPS_PER_TICK, &pickup_calls);
+  // a picked up body's creator still runs in the tick it is removed in
+  assert(idle_calls == NUM_TICKS * NUM_CREATORS);
+  size_t skipped_calls = PICKUPS_PER_TICK * NUM_TICKS * (NUM_TICKS - 1) / 2;
+  assert(pickup_calls == NUM_TICKS * NUM_CREATORS - skipped_calls);
+
+  printf("%zu force creators, %zu ticks, ms per tick:\n", NUM_CREATORS,
+         NUM_TICKS);
+  printf("  no pickups:              %7.3f\n", idle_time);
+  printf("  %zu pickups per tick:     %7.3f\n", PICKUPS_PER_TICK, pickup_time);
+  printf("  removal, us per pickup:  %7.3f\n",
+         (pickup_time - idle_time) * 1e3 / PICKUPS_PER_TICK);
+}
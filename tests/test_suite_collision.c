@@ -0,0 +1,239 @@
+#include "collision.h"
+#include "local_shape.h"
+#include "shape_view.h"
+#include "test_util.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+/**
+ * The number of allocations made since the program started.
+ * Counted by wrapping malloc, calloc and realloc at link time; see the
+ * Makefile's rule for this test suite.
+ */
+static size_t ALLOCATIONS = 0;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size) {
+  ALLOCATIONS++;
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+  ALLOCATIONS++;
+  return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+  ALLOCATIONS++;
+  return __real_realloc(ptr, size);
+}
+
+const color_t BLACK = {0, 0, 0};
+const size_t NUM_CALLS = 10000;
+
+list_t *make_shape(const vector_t *vertices, size_t size) {
+  list_t *shape = list_init(size, free);
+  for (size_t i = 0; i < size; i++) {
+    vector_t *vertex = malloc(sizeof(vector_t));
+    assert(vertex);
+    *vertex = vertices[i];
+    list_add(shape, vertex);
+  }
+  return shape;
+}
+
+body_t *make_box(vector_t center, double w, double h) {
+  vector_t vertices[] = {{center.x - w / 2, center.y - h / 2},
+                         {center.x + w / 2, center.y - h / 2},
+                         {center.x + w / 2, center.y + h / 2},
+                         {center.x - w / 2, center.y + h / 2}};
+  return body_init(make_shape(vertices, 4), 1, BLACK);
+}
+
+body_t *make_regular_polygon(vector_t center, double radius, size_t size) {
+  vector_t vertices[size];
+  for (size_t i = 0; i < size; i++) {
+    // offset by half a step so no edge is axis-aligned
+    double angle = 2 * M_PI * (i + 0.5) / size;
+    vertices[i] = (vector_t){center.x + radius * cos(angle),
+                             center.y + radius * sin(angle)};
+  }
+  return body_init(make_shape(vertices, size), 1, BLACK);
+}
+
+// the box-box fast path should agree with the general polygon test
+void test_box_box() {
+  body_t *box1 = make_box(VEC_ZERO, 2, 2);
+  body_t *box2 = make_box(VEC_ZERO, 3, 1);
+  for (double x = -3; x <= 3; x += 0.25) {
+    for (double y = -2; y <= 2; y += 0.25) {
+      body_set_centroid(box2, (vector_t){x, y});
+      list_t *shape1 = body_get_shape(box1);
+      list_t *shape2 = body_get_shape(box2);
+      vector_t vertices1[4];
+      vector_t vertices2[4];
+      for (size_t i = 0; i < 4; i++) {
+        vertices1[i] = *(vector_t *)list_get(shape1, i);
+        vertices2[i] = *(vector_t *)list_get(shape2, i);
+      }
+      list_free(shape1);
+      list_free(shape2);
+
+      collision_info_t expected =
+          find_polygon_collision(vertices1, 4, vertices2, 4);
+      collision_info_t info = find_collision(box1, box2);
+      assert(info.collided == expected.collided);
+      if (expected.collided) {
+        assert(vec_isclose(info.axis, expected.axis));
+      }
+    }
+  }
+  body_set_centroid(box2, (vector_t){3, 0});
+  assert(!find_collision(box1, box2).collided);
+  body_free(box1);
+  body_free(box2);
+}
+
+void test_polygon_polygon() {
+  body_t *shape1 = make_regular_polygon(VEC_ZERO, 1, 5);
+  body_t *shape2 = make_regular_polygon((vector_t){1.5, 0}, 1, 7);
+  collision_info_t info = find_collision(shape1, shape2);
+  assert(info.collided);
+  assert(isclose(vec_get_length(info.axis), 1));
+
+  body_set_centroid(shape2, (vector_t){0, 2.5});
+  assert(!find_collision(shape1, shape2).collided);
+  body_free(shape1);
+  body_free(shape2);
+}
+
+body_t *make_ellipse(vector_t center, double radius_x, double radius_y) {
+  const size_t size = 20;
+  vector_t vertices[size];
+  for (size_t i = 0; i < size; i++) {
+    double angle = 2 * M_PI * i / size;
+    vertices[i] = (vector_t){center.x + radius_x * cos(angle),
+                             center.y + radius_y * sin(angle)};
+  }
+  return body_init(make_shape(vertices, size), 1, BLACK);
+}
+
+// only a body declared an ellipse collides as one, and only while unrotated
+void test_ellipse() {
+  body_t *ellipse = make_ellipse(VEC_ZERO, 2, 1);
+  body_t *polygon = make_ellipse(VEC_ZERO, 2, 1);
+  shape_view_set_ellipse(ellipse);
+  assert(shape_view_get(ellipse).kind == SHAPE_ELLIPSE);
+  assert(shape_view_get(polygon).kind == SHAPE_POLYGON);
+
+  // reaches past the tessellation's edge, but not past the true ellipse
+  vector_t corners[] = {{1.96, 0.14}, {3, 0.14}, {3, 0.17}, {1.96, 0.17}};
+  body_t *box = body_init(make_shape(corners, 4), 1, BLACK);
+  assert(shape_view_get(box).kind == SHAPE_AABB);
+  collision_info_t info = find_collision(ellipse, box);
+  assert(info.collided);
+  assert(info.axis.x > 0 && isclose(vec_get_length(info.axis), 1));
+  assert(find_collision(box, ellipse).collided);
+  assert(!find_collision(polygon, box).collided);
+
+  body_set_rotation(ellipse, M_PI / 2);
+  assert(shape_view_get(ellipse).kind == SHAPE_POLYGON);
+  body_set_rotation(ellipse, 0);
+  assert(shape_view_get(ellipse).kind == SHAPE_ELLIPSE);
+
+  body_set_centroid(box, (vector_t){3.5, 0});
+  assert(!find_collision(ellipse, box).collided);
+  body_free(ellipse);
+  body_free(polygon);
+  body_free(box);
+}
+
+// bodies built from a shared shape are placed and tested from it, and keep it
+// alive until they are freed
+void test_local_shape() {
+  vector_t corners[] = {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+  local_shape_t *shape = local_shape_get(corners, 4);
+  body_t *box1 = body_init(local_shape_place(shape, VEC_ZERO), 1, BLACK);
+  body_t *box2 =
+      body_init(local_shape_place(shape, (vector_t){1.5, 0}), 1, BLACK);
+  body_set_local_shape(box1, shape);
+  body_set_local_shape(box2, shape);
+  local_shape_release(shape);
+  assert(body_get_local_shape(box1) == shape);
+
+  shape_view_t view = shape_view_get(box2);
+  assert(view.kind == SHAPE_AABB);
+  assert(vec_equal(view.min, (vector_t){0.5, -1}));
+  assert(vec_equal(view.max, (vector_t){2.5, 1}));
+  assert(shape_view_get_normals(box2) == local_shape_normals(shape));
+  assert(find_collision(box1, box2).collided);
+
+  body_set_centroid(box2, (vector_t){3, 0});
+  assert(!find_collision(box1, box2).collided);
+  body_free(box1);
+  // the other body's reference keeps the shape alive
+  assert(local_shape_size(body_get_local_shape(box2)) == 4);
+  body_free(box2);
+}
+
+void test_no_allocations() {
+  body_t *bodies[] = {make_box(VEC_ZERO, 2, 2),
+                      make_box((vector_t){1.5, 0}, 2, 2),
+                      make_regular_polygon((vector_t){0, 1.5}, 1, 5),
+                      make_regular_polygon((vector_t){3, 0.5}, 1, 20)};
+  size_t num_bodies = sizeof(bodies) / sizeof(bodies[0]);
+  // the first test of each body sets up its shape view
+  for (size_t i = 0; i < num_bodies; i++) {
+    for (size_t j = 0; j < num_bodies; j++) {
+      find_collision(bodies[i], bodies[j]);
+    }
+  }
+
+  size_t allocations = ALLOCATIONS;
+  size_t num_collided = 0;
+  for (size_t call = 0; call < NUM_CALLS; call++) {
+    body_t *body1 = bodies[call % num_bodies];
+    body_t *body2 = bodies[(call / num_bodies + 1) % num_bodies];
+    // moving a body makes the next test read its new vertices
+    vector_t centroid = body_get_centroid(body2);
+    body_set_centroid(body2, (vector_t){centroid.x, centroid.y + 1e-6});
+    num_collided += find_collision(body1, body2).collided;
+  }
+  allocations = ALLOCATIONS - allocations;
+  printf("find_collision: %zu calls, %zu collided, %.3f allocations per call\n",
+         NUM_CALLS, num_collided, (double)allocations / NUM_CALLS);
+  assert(allocations == 0);
+
+  // for comparison, copying out one shape the way find_collision used to
+  size_t copy_allocations = ALLOCATIONS;
+  list_free(body_get_shape(bodies[3]));
+  printf("body_get_shape: %zu allocations for a 20-vertex shape\n",
+         ALLOCATIONS - copy_allocations);
+
+  for (size_t i = 0; i < num_bodies; i++) {
+    body_free(bodies[i]);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_box_box)
+  DO_TEST(test_polygon_polygon)
+  DO_TEST(test_ellipse)
+  DO_TEST(test_local_shape)
+  DO_TEST(test_no_allocations)
+
+  puts("collision_test PASS");
+}
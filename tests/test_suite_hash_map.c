@@ -0,0 +1,122 @@
+#include "hash_map.h"
+#include "test_util.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+const size_t NUM_KEYS = 10000;
+
+/**
+ * Returns the key for the ith of a run of keys, spaced like the addresses of
+ * consecutive allocations.
+ */
+uint64_t key_of(size_t i) { return 0x7f0000001000 + 48 * i; }
+
+void test_put_get() {
+  hash_map_t *map = hash_map_init(0);
+  assert(hash_map_size(map) == 0);
+  assert(hash_map_get(map, 1) == HASH_MAP_NONE);
+  hash_map_put(map, 1, 10);
+  hash_map_put(map, 2, 20);
+  hash_map_put(map, 0, 0);
+  assert(hash_map_size(map) == 3);
+  assert(hash_map_get(map, 0) == 0);
+  assert(hash_map_get(map, 1) == 10);
+  assert(hash_map_get(map, 2) == 20);
+  hash_map_put(map, 1, 11);
+  assert(hash_map_size(map) == 3);
+  assert(hash_map_get(map, 1) == 11);
+  hash_map_free(map);
+}
+
+void test_grow() {
+  hash_map_t *map = hash_map_init(4);
+  for (size_t i = 0; i < NUM_KEYS; i++) {
+    hash_map_put(map, key_of(i), i);
+  }
+  assert(hash_map_size(map) == NUM_KEYS);
+  for (size_t i = 0; i < NUM_KEYS; i++) {
+    assert(hash_map_get(map, key_of(i)) == i);
+  }
+  assert(hash_map_get(map, key_of(NUM_KEYS)) == HASH_MAP_NONE);
+  hash_map_free(map);
+}
+
+void test_remove() {
+  hash_map_t *map = hash_map_init(0);
+  for (size_t i = 0; i < NUM_KEYS; i++) {
+    hash_map_put(map, key_of(i), i);
+  }
+  // removing every third key must not hide any key probed past it
+  for (size_t i = 0; i < NUM_KEYS; i += 3) {
+    assert(hash_map_remove(map, key_of(i)) == i);
+  }
+  assert(hash_map_remove(map, key_of(0)) == HASH_MAP_NONE);
+  for (size_t i = 0; i < NUM_KEYS; i++) {
+    size_t expected = i % 3 == 0 ? HASH_MAP_NONE : i;
+    assert(hash_map_get(map, key_of(i)) == expected);
+  }
+  assert(hash_map_size(map) == NUM_KEYS - (NUM_KEYS + 2) / 3);
+
+  for (size_t i = 0; i < NUM_KEYS; i += 3) {
+    hash_map_put(map, key_of(i), i);
+  }
+  for (size_t i = 0; i < NUM_KEYS; i++) {
+    assert(hash_map_remove(map, key_of(i)) == i);
+  }
+  assert(hash_map_size(map) == 0);
+  hash_map_free(map);
+}
+
+// interleaved puts and removes should match a plain array of values
+void test_random() {
+  const size_t num_keys = 500;
+  size_t *expected = malloc(num_keys * sizeof(size_t));
+  assert(expected);
+  for (size_t i = 0; i < num_keys; i++) {
+    expected[i] = HASH_MAP_NONE;
+  }
+  hash_map_t *map = hash_map_init(0);
+  srand(1);
+  for (size_t step = 0; step < 100 * num_keys; step++) {
+    size_t i = rand() % num_keys;
+    if (rand() % 2 == 0) {
+      hash_map_put(map, key_of(i), step);
+      expected[i] = step;
+    } else {
+      assert(hash_map_remove(map, key_of(i)) == expected[i]);
+      expected[i] = HASH_MAP_NONE;
+    }
+  }
+  size_t size = 0;
+  for (size_t i = 0; i < num_keys; i++) {
+    assert(hash_map_get(map, key_of(i)) == expected[i]);
+    size += expected[i] != HASH_MAP_NONE;
+  }
+  assert(hash_map_size(map) == size);
+
+  hash_map_clear(map);
+  assert(hash_map_size(map) == 0);
+  for (size_t i = 0; i < num_keys; i++) {
+    assert(hash_map_get(map, key_of(i)) == HASH_MAP_NONE);
+  }
+  hash_map_free(map);
+  free(expected);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_put_get)
+  DO_TEST(test_grow)
+  DO_TEST(test_remove)
+  DO_TEST(test_random)
+
+  puts("hash_map_test PASS");
+}
@@ -0,0 +1,574 @@
+#include "body_handle.h"
+#include "forces.h"
+#include "scene.h"
+#include "test_util.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+const color_t BLACK = {0, 0, 0};
+
+body_t *make_box(vector_t center) {
+  list_t *shape = list_init(4, free);
+  vector_t corners[] = {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+  for (size_t i = 0; i < 4; i++) {
+    vector_t *vertex = malloc(sizeof(vector_t));
+    assert(vertex);
+    *vertex = vec_add(center, corners[i]);
+    list_add(shape, vertex);
+  }
+  return body_init(shape, 1, BLACK);
+}
+
+/**
+ * A force creator's state: how often it ran, and whether it was freed.
+ */
+typedef struct {
+  size_t calls;
+  bool freed;
+} counter_t;
+
+void count_calls(void *aux, list_t *bodies) { ((counter_t *)aux)->calls++; }
+
+void mark_freed(void *aux) { ((counter_t *)aux)->freed = true; }
+
+void add_counter(scene_t *scene, counter_t *counter, body_t *body1,
+                 body_t *body2) {
+  list_t *bodies = list_init(2, NULL);
+  list_add(bodies, body1);
+  if (body2 != NULL) {
+    list_add(bodies, body2);
+  }
+  scene_add_force_creator(scene, count_calls, counter, bodies, mark_freed);
+}
+
+void test_tick_moves_bodies() {
+  scene_t *scene = scene_init();
+  body_t *body = make_box(VEC_ZERO);
+  scene_add_body(scene, body);
+  body_set_velocity(body, (vector_t){1, 2});
+  body_add_force(body, (vector_t){2, 0});
+  scene_tick(scene, 0.5);
+  // moves at the average of (1, 2) and (2, 2)
+  assert(vec_isclose(body_get_velocity(body), (vector_t){2, 2}));
+  assert(vec_isclose(body_get_centroid(body), (vector_t){0.75, 1}));
+  scene_tick(scene, 0.5);
+  assert(vec_isclose(body_get_velocity(body), (vector_t){2, 2}));
+  assert(vec_isclose(body_get_centroid(body), (vector_t){1.75, 2}));
+  scene_free(scene);
+}
+
+/**
+ * Checks that forces and impulses never move a body of the given mass, but
+ * that it still moves at the velocity it is given.
+ */
+static void check_infinite_mass(double mass) {
+  scene_t *scene = scene_init();
+  vector_t corners[] = {{0, 0}, {1, 0}, {0, 1}};
+  list_t *shape = list_init(3, free);
+  for (size_t i = 0; i < 3; i++) {
+    vector_t *vertex = malloc(sizeof(vector_t));
+    assert(vertex);
+    *vertex = corners[i];
+    list_add(shape, vertex);
+  }
+  body_t *wall = body_init(shape, mass, BLACK);
+  scene_add_body(scene, wall);
+  vector_t start = body_get_centroid(wall);
+  vector_t moved = vec_add(start, (vector_t){1, 0});
+  // large enough that 1 / mass times it would not round to 0
+  body_add_force(wall, (vector_t){1e300, 1e300});
+  body_add_impulse(wall, (vector_t){1e300, 1e300});
+  scene_tick(scene, 1);
+  assert(vec_equal(body_get_centroid(wall), start));
+  assert(vec_equal(body_get_velocity(wall), VEC_ZERO));
+  // a body with infinite mass still moves at the velocity it is given
+  body_set_velocity(wall, (vector_t){1, 0});
+  scene_tick(scene, 1);
+  assert(vec_isclose(body_get_centroid(wall), moved));
+  body_set_velocity(wall, VEC_ZERO);
+  scene_tick(scene, 1);
+  assert(vec_isclose(body_get_centroid(wall), moved));
+  scene_free(scene);
+}
+
+void test_infinite_mass() {
+  check_infinite_mass(INFINITY);
+  check_infinite_mass(__DBL_MAX__);
+}
+
+void test_remove_keeps_order() {
+  const size_t num_bodies = 10;
+  scene_t *scene = scene_init();
+  body_t *bodies[num_bodies];
+  for (size_t i = 0; i < num_bodies; i++) {
+    bodies[i] = make_box((vector_t){i, 0});
+    scene_add_body(scene, bodies[i]);
+  }
+  body_remove(bodies[0]);
+  body_remove(bodies[4]);
+  body_remove(bodies[4]);
+  body_remove(bodies[9]);
+  assert(scene_bodies(scene) == num_bodies);
+  scene_tick(scene, 1);
+
+  size_t expected[] = {1, 2, 3, 5, 6, 7, 8};
+  assert(scene_bodies(scene) == 7);
+  for (size_t i = 0; i < 7; i++) {
+    assert(scene_get_body(scene, i) == bodies[expected[i]]);
+    assert(vec_isclose(body_get_centroid(scene_get_body(scene, i)),
+                       (vector_t){expected[i], 0}));
+  }
+  scene_free(scene);
+}
+
+void test_remove_drops_creators() {
+  scene_t *scene = scene_init();
+  body_t *body1 = make_box(VEC_ZERO);
+  body_t *body2 = make_box((vector_t){5, 0});
+  body_t *body3 = make_box((vector_t){10, 0});
+  scene_add_body(scene, body1);
+  scene_add_body(scene, body2);
+  scene_add_body(scene, body3);
+  counter_t counters[4] = {0};
+  add_counter(scene, &counters[0], body1, body2);
+  add_counter(scene, &counters[1], body2, NULL);
+  add_counter(scene, &counters[2], body3, body1);
+  add_counter(scene, &counters[3], body3, NULL);
+
+  scene_tick(scene, 1);
+  body_remove(body2);
+  scene_tick(scene, 1);
+  // creators still run during the tick their body is removed in
+  assert(counters[0].calls == 2 && counters[0].freed);
+  assert(counters[1].calls == 2 && counters[1].freed);
+  assert(counters[2].calls == 2 && !counters[2].freed);
+  assert(counters[3].calls == 2 && !counters[3].freed);
+
+  scene_tick(scene, 1);
+  assert(counters[0].calls == 2);
+  assert(counters[2].calls == 3);
+  assert(scene_bodies(scene) == 2);
+
+  scene_free(scene);
+  assert(counters[2].freed && counters[3].freed);
+}
+
+void test_remove_before_add() {
+  scene_t *scene = scene_init();
+  body_t *body = make_box(VEC_ZERO);
+  body_remove(body);
+  scene_add_body(scene, body);
+  assert(body_is_removed(body));
+  scene_tick(scene, 1);
+  assert(scene_bodies(scene) == 0);
+  scene_free(scene);
+}
+
+void test_body_kinds() {
+  scene_t *scene = scene_init();
+  body_t *wall = make_box(VEC_ZERO);
+  body_t *platform = make_box((vector_t){5, 0});
+  scene_add_body(scene, wall);
+  scene_add_body(scene, platform);
+  body_set_kind(wall, BODY_STATIC);
+  body_set_kind(platform, BODY_KINEMATIC);
+  assert(body_get_kind(wall) == BODY_STATIC);
+  assert(body_get_kind(platform) == BODY_KINEMATIC);
+
+  body_set_velocity(wall, (vector_t){1, 0});
+  body_add_force(wall, (vector_t){1, 0});
+  body_set_velocity(platform, (vector_t){0, 1});
+  body_add_force(platform, (vector_t){1, 0});
+  body_add_impulse(platform, (vector_t){1, 0});
+  scene_tick(scene, 1);
+  assert(vec_equal(body_get_velocity(wall), VEC_ZERO));
+  assert(vec_equal(body_get_centroid(wall), VEC_ZERO));
+  // a kinematic body moves at its velocity, whatever is applied to it
+  assert(vec_isclose(body_get_velocity(platform), (vector_t){0, 1}));
+  assert(vec_isclose(body_get_centroid(platform), (vector_t){5, 1}));
+
+  body_set_kind(wall, BODY_DYNAMIC);
+  body_add_force(wall, (vector_t){2, 0});
+  scene_tick(scene, 1);
+  assert(vec_isclose(body_get_velocity(wall), (vector_t){2, 0}));
+  scene_free(scene);
+}
+
+void test_sleeping() {
+  const size_t sleep_ticks = 5;
+  scene_t *scene = scene_init();
+  body_t *body = make_box(VEC_ZERO);
+  body_t *platform = make_box((vector_t){5, 0});
+  body_t *wall = make_box((vector_t){-5, 0});
+  scene_add_body(scene, body);
+  scene_add_body(scene, platform);
+  scene_add_body(scene, wall);
+  body_set_kind(platform, BODY_KINEMATIC);
+  body_set_kind(wall, BODY_STATIC);
+  // one creator acts on the body and the wall, the other on both movers
+  counter_t resting_counter = {0};
+  list_t *resting_bodies = list_init(2, NULL);
+  list_add(resting_bodies, body);
+  list_add(resting_bodies, wall);
+  scene_add_force_creator(scene, count_calls, &resting_counter,
+                          resting_bodies, NULL);
+  counter_t moving_counter = {0};
+  list_t *moving_bodies = list_init(2, NULL);
+  list_add(moving_bodies, body);
+  list_add(moving_bodies, platform);
+  scene_add_force_creator(scene, count_calls, &moving_counter, moving_bodies,
+                          NULL);
+  body_set_velocity(body, (vector_t){0.5, 0});
+  body_set_velocity(platform, (vector_t){0.5, 0});
+  for (size_t i = 0; i < sleep_ticks; i++) {
+    scene_tick(scene, 1);
+  }
+  // bodies only fall asleep once the scene lets them
+  assert(!body_is_sleeping(body));
+  scene_set_sleeping(scene, 1, sleep_ticks);
+  for (size_t i = 0; i < sleep_ticks - 1; i++) {
+    scene_tick(scene, 1);
+    assert(!body_is_sleeping(body));
+  }
+  scene_tick(scene, 1);
+  assert(body_is_sleeping(body));
+  assert(!body_is_sleeping(platform));
+  assert(vec_equal(body_get_velocity(body), VEC_ZERO));
+  vector_t resting = body_get_centroid(body);
+  // a creator is not called while its only body that can move is asleep
+  size_t resting_calls = resting_counter.calls;
+  size_t moving_calls = moving_counter.calls;
+  scene_tick(scene, 1);
+  assert(vec_equal(body_get_centroid(body), resting));
+  assert(resting_counter.calls == resting_calls);
+  assert(moving_counter.calls == moving_calls + 1);
+
+  // setting a zero velocity leaves it asleep; a push wakes it
+  body_set_velocity(body, VEC_ZERO);
+  assert(body_is_sleeping(body));
+  body_add_impulse(body, (vector_t){2, 0});
+  assert(!body_is_sleeping(body));
+  scene_tick(scene, 1);
+  // it moves at the average of its speeds before and after the impulse
+  vector_t moved = vec_add(resting, (vector_t){1, 0});
+  assert(vec_isclose(body_get_centroid(body), moved));
+  assert(resting_counter.calls == resting_calls + 1);
+  scene_free(scene);
+}
+
+void test_previous_centroid() {
+  scene_t *scene = scene_init();
+  body_t *body = make_box(VEC_ZERO);
+  body_t *wall = make_box((vector_t){5, 0});
+  scene_add_body(scene, body);
+  scene_add_body(scene, wall);
+  body_set_kind(wall, BODY_STATIC);
+  body_set_velocity(body, (vector_t){1, 0});
+  scene_tick(scene, 1);
+  assert(vec_equal(body_get_previous_centroid(body), VEC_ZERO));
+  assert(vec_isclose(body_get_centroid(body), (vector_t){1, 0}));
+
+  // moving a moving body keeps where it was before the tick
+  body_set_centroid(body, (vector_t){2, 0});
+  assert(vec_equal(body_get_previous_centroid(body), VEC_ZERO));
+  scene_tick(scene, 1);
+  assert(vec_isclose(body_get_previous_centroid(body), (vector_t){2, 0}));
+
+  // ticking a single body saves its previous centroid the same way
+  vector_t before = body_get_centroid(body);
+  body_tick(body, 1);
+  assert(vec_equal(body_get_previous_centroid(body), before));
+  vector_t after = vec_add(before, (vector_t){1, 0});
+  assert(vec_isclose(body_get_centroid(body), after));
+
+  // a body that does not move has been where it is all along
+  body_set_centroid(wall, (vector_t){7, 0});
+  assert(vec_equal(body_get_previous_centroid(wall), (vector_t){7, 0}));
+  scene_free(scene);
+}
+
+void test_versions() {
+  scene_t *scene = scene_init();
+  body_t *body = make_box(VEC_ZERO);
+  body_t *wall = make_box((vector_t){5, 0});
+  scene_add_body(scene, body);
+  scene_add_body(scene, wall);
+  body_set_kind(wall, BODY_STATIC);
+  uint64_t version = body_get_version(body);
+  uint64_t wall_version = body_get_version(wall);
+  assert(version != wall_version);
+
+  // a tick that does not move a body keeps its version
+  scene_tick(scene, 1);
+  assert(body_get_version(body) == version);
+  body_set_velocity(body, (vector_t){1, 0});
+  scene_tick(scene, 1);
+  assert(body_get_version(body) != version);
+  assert(body_get_version(wall) == wall_version);
+
+  version = body_get_version(body);
+  body_set_rotation(body, 1);
+  assert(body_get_version(body) != version);
+  version = body_get_version(body);
+  body_set_centroid(wall, (vector_t){6, 0});
+  assert(body_get_version(wall) != wall_version);
+  body_tick(body, 1);
+  assert(body_get_version(body) != version);
+
+  // a body allocated after another is freed never shares its version
+  version = body_get_version(body);
+  body_remove(body);
+  scene_tick(scene, 1);
+  body_t *replacement = make_box(VEC_ZERO);
+  assert(body_get_version(replacement) != version);
+  body_free(replacement);
+  scene_free(scene);
+}
+
+void test_handles() {
+  scene_t *scene = scene_init();
+  body_t *body = make_box(VEC_ZERO);
+  body_t *other = make_box((vector_t){5, 0});
+  scene_add_body(scene, body);
+  scene_add_body(scene, other);
+  // the scene issued the handles, so asking again gives the same ones
+  body_handle_t handle = body_handle_issue(body);
+  body_handle_t other_handle = body_handle_issue(other);
+  assert(body_handle_resolve(handle) == body);
+
+  // a removed body keeps its handle until the tick that frees it
+  body_remove(body);
+  assert(body_handle_resolve(handle) == body);
+  scene_tick(scene, 1);
+  assert(body_handle_resolve(handle) == NULL);
+  assert(body_handle_resolve(other_handle) == other);
+
+  scene_free(scene);
+  assert(body_handle_resolve(other_handle) == NULL);
+  body_handle_destroy();
+}
+
+// the broadphase finds bodies by filter and follows them as they move, and
+// forgets removed ones
+void test_broadphase() {
+  const collision_filter_t WALL = {1, 2};
+  const collision_filter_t PLAYER = {2, 1};
+  scene_t *scene = scene_init();
+  body_t *wall = make_box(VEC_ZERO);
+  assert(body_get_filter(wall).layer == COLLISION_FILTER_ALL.layer);
+  body_set_kind(wall, BODY_STATIC);
+  body_set_filter(wall, WALL);
+  scene_add_body(scene, wall);
+  scene_set_broadphase(scene, 4);
+  body_t *player = make_box((vector_t){10, 0});
+  body_set_filter(player, PLAYER);
+  scene_add_body(scene, player);
+
+  list_t *found = scene_query_body(scene, player, PLAYER);
+  assert(list_size(found) == 0);
+  list_free(found);
+
+  // found where it was at the end of the tick that moved it
+  body_set_velocity(player, (vector_t){-9, 0});
+  scene_tick(scene, 1);
+  found = scene_query_body(scene, player, PLAYER);
+  assert(list_size(found) == 1 && list_get(found, 0) == wall);
+  list_free(found);
+  found = scene_query(scene, (vector_t){0, -1}, (vector_t){2, 1}, WALL);
+  assert(list_size(found) == 1 && list_get(found, 0) == player);
+  list_free(found);
+
+  body_remove(wall);
+  found = scene_query_body(scene, player, PLAYER);
+  assert(list_size(found) == 0);
+  list_free(found);
+  scene_tick(scene, 0);
+  scene_free(scene);
+}
+
+// static bodies are found once added, and again after they are moved or stop
+// being static, or are replaced
+void test_broadphase_geometry() {
+  scene_t *scene = scene_init();
+  scene_set_broadphase(scene, 4);
+  vector_t min = {-1, -1};
+  vector_t max = {1, 1};
+  list_t *found = scene_query(scene, min, max, COLLISION_FILTER_ALL);
+  assert(list_size(found) == 0);
+  list_free(found);
+
+  body_t *wall = make_box(VEC_ZERO);
+  body_set_kind(wall, BODY_STATIC);
+  scene_add_body(scene, wall);
+  found = scene_query(scene, min, max, COLLISION_FILTER_ALL);
+  assert(list_size(found) == 1 && list_get(found, 0) == wall);
+  list_free(found);
+
+  body_set_centroid(wall, (vector_t){10, 0});
+  scene_tick(scene, 1);
+  found = scene_query(scene, min, max, COLLISION_FILTER_ALL);
+  assert(list_size(found) == 0);
+  list_free(found);
+
+  // a body that stops being static is filed in the hash instead
+  body_set_kind(wall, BODY_KINEMATIC);
+  body_set_velocity(wall, (vector_t){-10, 0});
+  scene_tick(scene, 1);
+  found = scene_query(scene, min, max, COLLISION_FILTER_ALL);
+  assert(list_size(found) == 1 && list_get(found, 0) == wall);
+  list_free(found);
+
+  body_remove(wall);
+  body_t *other = make_box((vector_t){10, 0});
+  body_set_kind(other, BODY_STATIC);
+  scene_add_body(scene, other);
+  scene_tick(scene, 1);
+  found = scene_query(scene, min, max, COLLISION_FILTER_ALL);
+  assert(list_size(found) == 0);
+  list_free(found);
+  found = scene_query(scene, (vector_t){9, -1}, (vector_t){11, 1},
+                      COLLISION_FILTER_ALL);
+  assert(list_size(found) == 1 && list_get(found, 0) == other);
+  list_free(found);
+  scene_free(scene);
+}
+
+// a continuous body is stopped just inside a thin wall it would have passed
+// through in one tick, and other bodies are not
+void test_continuous() {
+  scene_t *scene = scene_init();
+  scene_set_broadphase(scene, 4);
+  body_t *wall = make_box(VEC_ZERO);
+  body_set_kind(wall, BODY_STATIC);
+  scene_add_body(scene, wall);
+  body_t *fast = make_box((vector_t){-5, 0});
+  // collides with nothing, so the fast body is not stopped by it either
+  body_t *ghost = make_box((vector_t){-5, 0});
+  body_set_filter(ghost, (collision_filter_t){2, 0});
+  body_set_continuous(fast, true);
+  assert(body_is_continuous(fast) && !body_is_continuous(ghost));
+  scene_add_body(scene, fast);
+  scene_add_body(scene, ghost);
+  body_set_velocity(fast, (vector_t){10, 0});
+  body_set_velocity(ghost, (vector_t){10, 0});
+  scene_tick(scene, 1);
+
+  // the boxes first touch once the fast one has moved 3 units
+  vector_t centroid = body_get_centroid(fast);
+  assert(centroid.x > -2 && centroid.x < -1.9);
+  assert(vec_equal(body_get_previous_centroid(fast), (vector_t){-5, 0}));
+  assert(vec_equal(body_get_centroid(ghost), (vector_t){5, 0}));
+  scene_free(scene);
+}
+
+void count_collisions(body_t *body1, body_t *body2, vector_t axis, void *aux,
+                      double force_const) {
+  ((counter_t *)aux)->calls++;
+}
+
+/**
+ * Returns the type of the only event of a scene's last tick.
+ */
+contact_event_type_t only_event(scene_t *scene) {
+  const contact_event_t *events;
+  assert(scene_get_contact_events(scene, &events) == 1);
+  return events[0].type;
+}
+
+// collision creators share the scene's contacts, so a handler is called
+// once when the contact begins, and the contact persists and then ends
+void test_collision_contacts() {
+  scene_t *scene = scene_init();
+  body_t *body1 = make_box(VEC_ZERO);
+  body_t *body2 = make_box((vector_t){3, 0});
+  scene_add_body(scene, body1);
+  scene_add_body(scene, body2);
+  counter_t counter1 = {0};
+  counter_t counter2 = {0};
+  create_collision(scene, body1, body2, count_collisions, &counter1, 0, NULL);
+  create_collision(scene, body1, body2, count_collisions, &counter2, 0, NULL);
+  scene_tick(scene, 1);
+  const contact_event_t *events;
+  assert(scene_get_contact_events(scene, &events) == 0);
+
+  body_set_centroid(body2, (vector_t){1.5, 0});
+  scene_tick(scene, 1);
+  assert(only_event(scene) == CONTACT_BEGIN);
+  scene_tick(scene, 1);
+  assert(only_event(scene) == CONTACT_PERSIST);
+  assert(counter1.calls == 1 && counter2.calls == 1);
+
+  body_set_centroid(body2, (vector_t){3, 0});
+  scene_tick(scene, 1);
+  assert(only_event(scene) == CONTACT_END);
+  body_set_centroid(body2, (vector_t){1.5, 0});
+  scene_tick(scene, 1);
+  assert(counter1.calls == 2 && counter2.calls == 2);
+
+  // bodies whose filters do not collide are never tested
+  body_t *ghost = make_box(VEC_ZERO);
+  body_set_filter(ghost, (collision_filter_t){2, 0});
+  scene_add_body(scene, ghost);
+  counter_t ghost_counter = {0};
+  create_collision(scene, body1, ghost, count_collisions, &ghost_counter, 0,
+                   NULL);
+  scene_tick(scene, 1);
+  assert(ghost_counter.calls == 0);
+  scene_free(scene);
+}
+
+// a physics collision bounces a body off a wall once, however long they
+// overlap
+void test_physics_collision() {
+  scene_t *scene = scene_init();
+  body_t *ball = make_box(VEC_ZERO);
+  list_t *shape = list_init(4, free);
+  vector_t corners[] = {{1.5, -5}, {2.5, -5}, {2.5, 5}, {1.5, 5}};
+  for (size_t i = 0; i < 4; i++) {
+    vector_t *vertex = malloc(sizeof(vector_t));
+    assert(vertex);
+    *vertex = corners[i];
+    list_add(shape, vertex);
+  }
+  body_t *wall = body_init(shape, INFINITY, BLACK);
+  scene_add_body(scene, ball);
+  scene_add_body(scene, wall);
+  create_physics_collision(scene, ball, wall, 1);
+  body_set_velocity(ball, (vector_t){1, 0});
+  for (size_t i = 0; i < 3; i++) {
+    scene_tick(scene, 0.5);
+  }
+  assert(vec_isclose(body_get_velocity(ball), (vector_t){-1, 0}));
+  assert(vec_equal(body_get_velocity(wall), VEC_ZERO));
+  scene_free(scene);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_tick_moves_bodies)
+  DO_TEST(test_infinite_mass)
+  DO_TEST(test_remove_keeps_order)
+  DO_TEST(test_remove_drops_creators)
+  DO_TEST(test_remove_before_add)
+  DO_TEST(test_body_kinds)
+  DO_TEST(test_sleeping)
+  DO_TEST(test_previous_centroid)
+  DO_TEST(test_versions)
+  DO_TEST(test_handles)
+  DO_TEST(test_broadphase)
+  DO_TEST(test_broadphase_geometry)
+  DO_TEST(test_continuous)
+  DO_TEST(test_collision_contacts)
+  DO_TEST(test_physics_collision)
+
+  puts("scene_test PASS");
+}